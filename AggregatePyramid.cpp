@@ -0,0 +1,179 @@
+//AggregatePyramid.cpp
+#include "stdafx.h"
+#include "AggregatePyramid.h"
+#include "Utility.h"
+
+//Multi resolution summaries of the graph. Since shifting a z-order key
+//right by three bits gives the key of the cell twice as large, the cells
+//of a level come out of the level below in key order and each level can
+//be built by splitting the level below into runs between the workers.
+//Like the region table it holds the primary readings, never the channel mix
+
+//builds every level from the column store, which is already in key order
+void AggregatePyramid::build(const NodeColumns& columns) {
+	vector<PyramidCell> readings, level;
+	PyramidCell cell;
+
+	clear();
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.nodes[i]->val != VACANT) {
+			cell.key = columns.keys[i];
+			cell.count = 1;
+			cell.sum = columns.nodes[i]->val;
+			cell.max = columns.nodes[i]->val;
+			readings.push_back(cell);
+		}
+	}
+
+	level = merge_level(readings, 0);
+
+	for (int depth = 0; depth < PYRAMID_LEVELS; depth++) {
+		levels.push_back(map<uint64_t, PyramidCell>());
+
+		for (PyramidCell& merged : level) {
+			levels.back().emplace_hint(levels.back().end(), merged.key, merged);
+		}
+
+		if (depth + 1 < PYRAMID_LEVELS) {
+			level = merge_level(level, 3);
+		}
+	}
+
+	built = true;
+}
+
+//combines runs of cells that share the same key once shifted down. Every
+//worker takes a slice of the input, moved forward so no run is split
+vector<PyramidCell> AggregatePyramid::merge_level(const vector<PyramidCell>& below, const int shift) {
+	vector<vector<PyramidCell>> slices(Utility::thread_count());
+	vector<PyramidCell> merged;
+
+	Utility::parallel_for(below.size(), [&](size_t chunk, size_t begin, size_t end) {
+		PyramidCell cell;
+
+		//the previous slice owns the run this one starts in the middle of
+		while (begin > 0 && begin < end &&
+			(below[begin].key >> shift) == (below[begin - 1].key >> shift)) {
+			begin++;
+		}
+		//finish the run that crosses the end of the slice
+		while (end < below.size() && end > begin &&
+			(below[end].key >> shift) == (below[end - 1].key >> shift)) {
+			end++;
+		}
+
+		for (size_t i = begin; i < end; i++) {
+			if (slices[chunk].empty() || slices[chunk].back().key != (below[i].key >> shift)) {
+				cell = below[i];
+				cell.key = below[i].key >> shift;
+				slices[chunk].push_back(cell);
+			}
+			else {
+				slices[chunk].back().count += below[i].count;
+				slices[chunk].back().sum += below[i].sum;
+				slices[chunk].back().max = max(slices[chunk].back().max, below[i].max);
+			}
+		}
+	});
+
+	for (vector<PyramidCell>& slice : slices) {
+		merged.insert(merged.end(), slice.begin(), slice.end());
+	}
+	return merged;
+}
+
+//applies the change of a reading at the given z-order key. values holds every
+//reading left at that position, which is needed when the maximum is lowered.
+//each level above only has to look at the 8 cells beneath it
+void AggregatePyramid::update(uint64_t key, int old_val, int new_val, const vector<int>& values) {
+	long long count = (new_val != VACANT) - (old_val != VACANT);
+	long long sum = (new_val != VACANT ? new_val : 0) - (old_val != VACANT ? old_val : 0);
+	map<uint64_t, PyramidCell>::iterator cell, child;
+	PyramidCell empty = { 0, 0, 0, VACANT };
+
+	if (!built) {
+		return;
+	}
+
+	for (int depth = 0; depth < PYRAMID_LEVELS; depth++, key >>= 3) {
+		empty.key = key;
+		cell = levels[depth].insert(make_pair(key, empty)).first;
+		cell->second.count += count;
+		cell->second.sum += sum;
+		cell->second.max = VACANT;
+
+		if (depth == 0) {
+			for (int val : values) {
+				cell->second.max = max(cell->second.max, val);
+			}
+		}
+		else {
+			for (uint64_t octant = 0; octant < 8; octant++) {
+				if ((child = levels[depth - 1].find((key << 3) | octant)) != levels[depth - 1].end()) {
+					cell->second.max = max(cell->second.max, child->second.max);
+				}
+			}
+		}
+
+		if (cell->second.count <= 0) {
+			levels[depth].erase(cell);
+		}
+	}
+}
+
+//every occupied cell of a level that overlaps the box between two corners
+vector<PyramidCell> AggregatePyramid::cells(int depth, const Position& low, const Position& high) const {
+	vector<PyramidCell> found;
+	Position lower, upper;
+	uint64_t low_key, high_key, next;
+
+	if (!built || depth < 0 || depth >= PYRAMID_LEVELS) {
+		return found;
+	}
+
+	//work in the cell coordinates of the level
+	lower.x = ((min(low.x, high.x) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+	lower.y = ((min(low.y, high.y) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+	lower.z = ((min(low.z, high.z) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+	upper.x = ((max(low.x, high.x) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+	upper.y = ((max(low.y, high.y) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+	upper.z = ((max(low.z, high.z) + MORTON_BIAS) >> depth) - MORTON_BIAS;
+
+	low_key = Utility::morton_encode(lower);
+	high_key = Utility::morton_encode(upper);
+
+	auto it = levels[depth].lower_bound(low_key);
+
+	while (it != levels[depth].end() && it->first <= high_key) {
+		if (Utility::in_box(Utility::morton_decode(it->first), lower, upper)) {
+			found.push_back(it->second);
+			++it;
+		}
+		else if ((next = Utility::morton_bigmin(it->first, low_key, high_key)) > it->first) {
+			it = levels[depth].lower_bound(next);
+		}
+		else {
+			break;
+		}
+	}
+	return found;
+}
+
+//the lowest corner, in graph coordinates, of a cell at the given level
+Position AggregatePyramid::cell_corner(int depth, uint64_t key) const {
+	Position pos = Utility::morton_decode(key);
+
+	pos.x = ((pos.x + MORTON_BIAS) << depth) - MORTON_BIAS;
+	pos.y = ((pos.y + MORTON_BIAS) << depth) - MORTON_BIAS;
+	pos.z = ((pos.z + MORTON_BIAS) << depth) - MORTON_BIAS;
+
+	return pos;
+}
+
+bool AggregatePyramid::is_built() const { return built; }
+
+void AggregatePyramid::clear() {
+	levels.clear();
+	built = false;
+}
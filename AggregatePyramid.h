@@ -0,0 +1,35 @@
+#ifndef AGGREGATEPYRAMID_H
+#define AGGREGATEPYRAMID_H
+
+#include "NodeColumns.h"
+
+#define PYRAMID_LEVELS 9
+
+//summary of the readings inside of one cell of a pyramid level. The key is
+//the z-order key of the readings shifted down by three bits per level
+struct PyramidCell {
+	uint64_t key;
+	long long count, sum;
+	int max;
+};
+
+//mipmap style levels of summaries over the resolved grid. Level 0 holds one
+//cell per occupied position and every level above merges 2x2x2 cells of the
+//level beneath it, so level 2 cells are 4^3 and level 4 cells are 16^3
+class AggregatePyramid {
+
+public:
+	void build(const NodeColumns&);
+	void update(uint64_t, int, int, const vector<int>&);
+	vector<PyramidCell> cells(int, const Position&, const Position&) const;
+	Position cell_corner(int, uint64_t) const;
+	bool is_built() const;
+	void clear();
+
+private:
+	bool built = false;
+	vector<map<uint64_t, PyramidCell>> levels;
+	vector<PyramidCell> merge_level(const vector<PyramidCell>&, const int);
+};
+
+#endif // !AGGREGATEPYRAMID_H
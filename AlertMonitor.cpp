@@ -0,0 +1,168 @@
+//AlertMonitor.cpp
+#include "stdafx.h"
+#include "AlertMonitor.h"
+#include "Utility.h"
+#include <chrono>
+
+//Threshold alerts checked as readings change instead of by polling the
+//graph. The zones are sorted by the low end of their x range and laid out
+//as an implicit balanced tree, the middle of every span being the root of
+//it, with reach holding the furthest x any zone in the span covers. A
+//check walks only the spans whose reach gets to the reading's x, so it
+//costs O(log S) plus the zones overlapping it in x, and y and z are then
+//compared for those alone. Zones change rarely next to readings, so the
+//tree is rebuilt whenever one is added or removed.
+//The graph thread is the only producer on the queue and the notifier the
+//only consumer. The notifier sleeps ALERT_IDLE_MS whenever it finds the
+//queue empty rather than spinning
+
+AlertMonitor::AlertMonitor() : pending(ALERT_QUEUE_DEPTH) {}
+
+//delivers whatever is still queued before returning
+AlertMonitor::~AlertMonitor() {
+	if (notifier.joinable()) {
+		stopping.store(true, memory_order_release);
+		notifier.join();
+	}
+}
+
+//watches the box between the two corners for readings rising to the
+//threshold. Returns the id to unsubscribe with
+size_t AlertMonitor::subscribe(Position low, Position high, int threshold,
+	const function<void(const Alert&)>& callback) {
+
+	shared_ptr<AlertSubscription> zone = make_shared<AlertSubscription>();
+
+	zone->id = next_id++;
+	zone->low[0] = min(low.x, high.x); zone->high[0] = max(low.x, high.x);
+	zone->low[1] = min(low.y, high.y); zone->high[1] = max(low.y, high.y);
+	zone->low[2] = min(low.z, high.z); zone->high[2] = max(low.z, high.z);
+	zone->threshold = threshold;
+	zone->callback = callback;
+
+	zones.push_back(zone);
+	rebuild();
+
+	if (!notifier.joinable()) {
+		notifier = thread(&AlertMonitor::notify, this);
+	}
+	return zone->id;
+}
+
+//stops watching a zone. Alerts for it already queued are still delivered
+bool AlertMonitor::unsubscribe(size_t id) {
+	for (size_t i = 0; i < zones.size(); i++) {
+		if (zones[i]->id == id) {
+			zones.erase(zones.begin() + i);
+			rebuild();
+			return true;
+		}
+	}
+	return false;
+}
+
+//called with every change of value. Queues an alert for each zone that
+//holds the position and whose threshold the reading rose past
+void AlertMonitor::check(const Position& pos, const string& coordinate, int old_val, int new_val) {
+	//a reading that did not rise can not cross anything
+	if (zones.empty() || new_val == VACANT || (old_val != VACANT && new_val <= old_val)) {
+		return;
+	}
+
+	checked++;
+	stab(0, zones.size(), pos, coordinate, old_val, new_val);
+}
+
+//visits the zones of the span [begin, end) whose x range holds pos.x
+void AlertMonitor::stab(size_t begin, size_t end, const Position& pos, const string& coordinate,
+	int old_val, int new_val) {
+
+	const AlertSubscription* zone;
+	size_t mid;
+
+	while (begin < end) {
+		mid = (begin + end) / 2;
+
+		if (reach[mid] < pos.x) {
+			return;
+		}
+		stab(begin, mid, pos, coordinate, old_val, new_val);
+
+		//the zones right of the middle all start further along
+		zone = zones[mid].get();
+		if (zone->low[0] > pos.x) {
+			return;
+		}
+
+		if (zone->high[0] >= pos.x && pos.y >= zone->low[1] && pos.y <= zone->high[1] &&
+			pos.z >= zone->low[2] && pos.z <= zone->high[2] &&
+			(old_val == VACANT || old_val < zone->threshold) && new_val >= zone->threshold) {
+
+			pending.push(new Alert{ zones[mid], coordinate, pos.x, pos.y, pos.z, new_val, old_val });
+			queued.fetch_add(1, memory_order_relaxed);
+		}
+		begin = mid + 1;
+	}
+}
+
+//sorts the zones and works out the reach of every span
+void AlertMonitor::rebuild() {
+	sort(zones.begin(), zones.end(), [](const shared_ptr<const AlertSubscription>& a,
+		const shared_ptr<const AlertSubscription>& b) {
+		return a->low[0] < b->low[0];
+	});
+
+	reach.assign(zones.size(), INT32_MIN);
+	build_reach(0, zones.size());
+}
+
+//the furthest x covered within [begin, end), stored at its middle
+int AlertMonitor::build_reach(size_t begin, size_t end) {
+	size_t mid;
+
+	if (begin >= end) {
+		return INT32_MIN;
+	}
+
+	mid = (begin + end) / 2;
+	reach[mid] = max(zones[mid]->high[0], max(build_reach(begin, mid), build_reach(mid + 1, end)));
+	return reach[mid];
+}
+
+//the notifier thread. Runs the callbacks in the order the alerts were
+//raised. Once stopping is seen nothing more can be pushed, so emptying the
+//queue one last time delivers everything
+void AlertMonitor::notify() {
+	Alert* alert;
+	bool last_pass;
+
+	while (true) {
+		last_pass = stopping.load(memory_order_acquire);
+
+		while (pending.try_pop(alert)) {
+			alert->subscription->callback(*alert);
+			delete alert;
+			delivered.fetch_add(1, memory_order_release);
+		}
+
+		if (last_pass) {
+			return;
+		}
+		this_thread::sleep_for(chrono::milliseconds(ALERT_IDLE_MS));
+	}
+}
+
+//waits until every alert raised so far has been delivered
+void AlertMonitor::drain() {
+	while (delivered.load(memory_order_acquire) < queued.load(memory_order_relaxed)) {
+		this_thread::yield();
+	}
+}
+
+bool AlertMonitor::is_watching() const { return !zones.empty(); }
+
+size_t AlertMonitor::get_subscriptions() const { return zones.size(); }
+
+unsigned long long AlertMonitor::get_checked() const { return checked; }
+
+unsigned long long AlertMonitor::get_delivered() const { return delivered.load(memory_order_acquire); }
@@ -0,0 +1,67 @@
+#ifndef ALERTMONITOR_H
+#define ALERTMONITOR_H
+
+#include "NodeColumns.h"
+#include "BoundedQueue.h"
+#include <string>
+#include <memory>
+#include <functional>
+
+#define ALERT_QUEUE_DEPTH 4096
+#define ALERT_IDLE_MS 1
+
+struct Alert;
+
+//a protected zone being watched. Any reading inside of the box from low to
+//high (x, y and z) that rises from below threshold to at least threshold
+//is handed to callback
+struct AlertSubscription {
+	size_t id;
+	int low[3], high[3];
+	int threshold;
+	function<void(const Alert&)> callback;
+};
+
+//one reading that crossed a subscription's threshold
+struct Alert {
+	shared_ptr<const AlertSubscription> subscription;
+	string coordinate;
+	int x, y, z;
+	int value, previous;
+};
+
+//holds the subscriptions in an interval tree over x so a changed reading
+//is only checked against the zones whose x range covers it. Crossings are
+//queued to a notifier thread which runs the callbacks, so a slow callback
+//only holds up the graph once ALERT_QUEUE_DEPTH alerts are waiting on it
+class AlertMonitor {
+
+public:
+	AlertMonitor();
+	~AlertMonitor();
+	size_t subscribe(Position, Position, int, const function<void(const Alert&)>&);
+	bool unsubscribe(size_t);
+	void check(const Position&, const string&, int, int);
+	bool is_watching() const;
+	size_t get_subscriptions() const;
+	unsigned long long get_checked() const;
+	unsigned long long get_delivered() const;
+	void drain();
+
+private:
+	vector<shared_ptr<const AlertSubscription>> zones;
+	vector<int> reach;
+	size_t next_id = 1;
+	unsigned long long checked = 0;
+	atomic<unsigned long long> queued{ 0 }, delivered{ 0 };
+	BoundedQueue<Alert*> pending;
+	thread notifier;
+	atomic<bool> stopping{ false };
+
+	void rebuild();
+	int build_reach(size_t, size_t);
+	void stab(size_t, size_t, const Position&, const string&, int, int);
+	void notify();
+};
+
+#endif // !ALERTMONITOR_H
@@ -0,0 +1,206 @@
+//ApproximateStats.cpp
+#include "stdafx.h"
+#include "ApproximateStats.h"
+#include "Utility.h"
+
+//The reservoir follows random pairing (Gemulla, Lehner and Haas) so that
+//it stays a uniform sample while readings are removed as well as added. A
+//removal that takes a reading out of the sample leaves a hole and one that
+//does not is noted as well. The next readings to arrive are paired off
+//against those removals, filling holes in the same proportion they were
+//made, before plain reservoir sampling takes over again. An overwrite only
+//changes the value of a sampled reading
+
+ApproximateStats::ApproximateStats() : random(RESERVOIR_SIZE) {}
+
+//lays the sample and sketches down from the columns. Each worker sketches
+//its share of the readings and the sketches are merged in order
+void ApproximateStats::build(const NodeColumns& columns) {
+	vector<QuantileSketch> partials;
+
+	clear();
+	partials.reserve(Utility::thread_count());
+
+	for (size_t i = 0; i < Utility::thread_count(); i++) {
+		partials.push_back(QuantileSketch((unsigned)i + 1));
+	}
+
+	Utility::parallel_for(columns.size(), [&](size_t chunk, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (columns.nodes[i]->val != VACANT) {
+				partials[chunk].insert(columns.nodes[i]->val);
+			}
+		}
+	});
+
+	for (QuantileSketch& partial : partials) {
+		arrived.merge(partial);
+	}
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.nodes[i]->val != VACANT) {
+			add_reading(columns.nodes[i]->location_info, columns.nodes[i]->val);
+		}
+	}
+	built = true;
+}
+
+//called with every change of value, either side of which may be VACANT
+void ApproximateStats::update(const Location* location, int old_val, int new_val) {
+	unordered_map<const Location*, size_t>::iterator found;
+
+	if (old_val == new_val) {
+		return;
+	}
+	if (old_val != VACANT) {
+		left.insert(old_val);
+	}
+	if (new_val != VACANT) {
+		arrived.insert(new_val);
+	}
+
+	if (old_val != VACANT && new_val != VACANT) {
+		if ((found = sampled.find(location)) != sampled.end()) {
+			sample[found->second].second = new_val;
+		}
+	}
+	else if (new_val != VACANT) {
+		add_reading(location, new_val);
+	}
+	else {
+		drop_reading(location);
+	}
+}
+
+//offers a reading that was not there before to the sample
+void ApproximateStats::add_reading(const Location* location, int val) {
+	size_t victim;
+
+	readings++;
+
+	if (missed_in + missed_out == 0) {
+		if (sample.size() < RESERVOIR_SIZE) {
+			sampled[location] = sample.size();
+			sample.push_back(pair<const Location*, int>(location, val));
+		}
+		else if (random() % readings < RESERVOIR_SIZE) {
+			victim = random() % RESERVOIR_SIZE;
+			sampled.erase(sample[victim].first);
+			sampled[location] = victim;
+			sample[victim] = pair<const Location*, int>(location, val);
+		}
+	}
+	else if (random() % (missed_in + missed_out) < missed_in) {
+		sampled[location] = sample.size();
+		sample.push_back(pair<const Location*, int>(location, val));
+		missed_in--;
+	}
+	else {
+		missed_out--;
+	}
+}
+
+//takes a reading that is no longer there out of the sample
+void ApproximateStats::drop_reading(const Location* location) {
+	unordered_map<const Location*, size_t>::iterator found = sampled.find(location);
+
+	readings--;
+
+	if (found == sampled.end()) {
+		missed_out++;
+		return;
+	}
+
+	sample[found->second] = sample.back();
+	sampled[sample.back().first] = found->second;
+	sample.pop_back();
+	sampled.erase(location);
+	missed_in++;
+}
+
+//mean of the readings estimated from the sample. error is set to the half
+//width of its 95% confidence interval
+double ApproximateStats::mean(double* error) const {
+	double sum = 0, squares = 0, average, variance;
+	double size = (double)sample.size();
+
+	*error = 0;
+
+	if (sample.empty()) {
+		return 0;
+	}
+
+	for (const pair<const Location*, int>& entry : sample) {
+		sum += entry.second;
+		squares += (double)entry.second * entry.second;
+	}
+
+	average = sum / size;
+	variance = sample.size() > 1 ? (squares - size * average * average) / (size - 1) : 0;
+
+	//drawn without replacement, so the error shrinks to nothing as the
+	//sample grows to be every reading
+	*error = 1.96 * sqrt(max(variance, 0.0) / size * (1 - size / max((double)readings, size)));
+	return average;
+}
+
+//the value at the given fraction of the readings (0.5 for the median).
+//error is set to how far off its rank may be, as a fraction of the readings
+int ApproximateStats::percentile(const double fraction, double* error) const {
+	vector<pair<int, long long>> values;
+	long long target, seen = 0;
+
+	*error = 0;
+
+	if (readings <= 0) {
+		return VACANT;
+	}
+
+	arrived.weighted_values(values, 1);
+	left.weighted_values(values, -1);
+	sort(values.begin(), values.end());
+
+	target = max(1LL, (long long)ceil(fraction * readings));
+
+	*error = SKETCH_RANK_ERROR * (arrived.count() + left.count()) / readings;
+
+	for (const pair<int, long long>& entry : values) {
+		seen += entry.second;
+
+		if (seen >= target) {
+			return entry.first;
+		}
+	}
+	return values.empty() ? VACANT : values.back().first;
+}
+
+//how many times each value occurs in the sample
+map<int, int> ApproximateStats::sample_occurrences() const {
+	map<int, int> occurrences;
+
+	for (const pair<const Location*, int>& entry : sample) {
+		occurrences[entry.second]++;
+	}
+	return occurrences;
+}
+
+long long ApproximateStats::get_readings() const { return readings; }
+
+size_t ApproximateStats::get_sample_size() const { return sample.size(); }
+
+size_t ApproximateStats::get_sketch_size() const { return arrived.retained() + left.retained(); }
+
+bool ApproximateStats::is_built() const { return built; }
+
+//true once more readings have left than remain
+bool ApproximateStats::is_stale() const { return left.count() > (unsigned long long)max(readings, 0LL); }
+
+void ApproximateStats::clear() {
+	sample.clear();
+	sampled.clear();
+	arrived.clear();
+	left.clear();
+	readings = 0;
+	missed_in = missed_out = 0;
+	built = false;
+}
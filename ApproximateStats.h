@@ -0,0 +1,49 @@
+#ifndef APPROXIMATESTATS_H
+#define APPROXIMATESTATS_H
+
+#include "NodeColumns.h"
+#include "QuantileSketch.h"
+#include <unordered_map>
+
+#define RESERVOIR_SIZE 4096
+
+struct Location;
+
+//statistics of the readings answered from a fixed amount of memory kept up
+//to date as readings change, instead of from a pass over the graph.
+//A reservoir holds a uniform random sample of the current readings, which
+//the mean and the shape of the distribution come from. Every reading that
+//arrives goes into one quantile sketch and every one that leaves (a removal
+//or the old side of an overwrite) into another, and percentiles are read
+//off of the first less the second. Once more readings have left than remain
+//the difference is too loose to trust and the sketches ask to be rebuilt
+class ApproximateStats {
+
+public:
+	ApproximateStats();
+	void build(const NodeColumns&);
+	void update(const Location*, int, int);
+	double mean(double*) const;
+	int percentile(const double, double*) const;
+	map<int, int> sample_occurrences() const;
+	long long get_readings() const;
+	size_t get_sample_size() const;
+	size_t get_sketch_size() const;
+	bool is_built() const;
+	bool is_stale() const;
+	void clear();
+
+private:
+	vector<pair<const Location*, int>> sample;
+	unordered_map<const Location*, size_t> sampled;
+	QuantileSketch arrived, left;
+	long long readings = 0;
+	unsigned long long missed_in = 0, missed_out = 0;
+	mt19937_64 random;
+	bool built = false;
+
+	void add_reading(const Location*, int);
+	void drop_reading(const Location*);
+};
+
+#endif // !APPROXIMATESTATS_H
@@ -0,0 +1,123 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cstdint>
+
+using namespace std;
+
+//fixed size lock free queue that any number of threads may push to and pop
+//from. Every slot carries a sequence number that tells a producer when the
+//slot is free and a consumer when it is filled, so the only contention is
+//one compare and swap on the head or the tail. The capacity is rounded up
+//to a power of two. push waits while the queue is full, which is what
+//holds a fast stage back to the pace of the one after it
+template <typename T>
+class BoundedQueue {
+
+public:
+	BoundedQueue(size_t capacity) {
+		size_t size = 2;
+
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		slots = vector<Slot>(size);
+		mask = size - 1;
+
+		for (size_t i = 0; i < size; i++) {
+			slots[i].sequence.store(i, memory_order_relaxed);
+		}
+	}
+
+	bool try_push(const T& item) {
+		size_t pos = tail.load(memory_order_relaxed);
+		Slot* slot;
+		intptr_t diff;
+
+		while (true) {
+			slot = &slots[pos & mask];
+			diff = (intptr_t)slot->sequence.load(memory_order_acquire) - (intptr_t)pos;
+
+			if (diff == 0 && tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+				break;
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else if (diff > 0) {
+				pos = tail.load(memory_order_relaxed);
+			}
+		}
+
+		slot->item = item;
+		slot->sequence.store(pos + 1, memory_order_release);
+		return true;
+	}
+
+	bool try_pop(T& item) {
+		size_t pos = head.load(memory_order_relaxed);
+		Slot* slot;
+		intptr_t diff;
+
+		while (true) {
+			slot = &slots[pos & mask];
+			diff = (intptr_t)slot->sequence.load(memory_order_acquire) - (intptr_t)(pos + 1);
+
+			if (diff == 0 && head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+				break;
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else if (diff > 0) {
+				pos = head.load(memory_order_relaxed);
+			}
+		}
+
+		item = slot->item;
+		slot->sequence.store(pos + mask + 1, memory_order_release);
+		return true;
+	}
+
+	void push(const T& item) {
+		while (!try_push(item)) {
+			this_thread::yield();
+		}
+	}
+
+	//waits for an item. Returns false once the queue is closed and empty
+	bool pop(T& item) {
+		while (!try_pop(item)) {
+			if (closed.load(memory_order_acquire)) {
+				return try_pop(item);
+			}
+			this_thread::yield();
+		}
+		return true;
+	}
+
+	//no more items will be pushed
+	void close() { closed.store(true, memory_order_release); }
+
+private:
+	struct Slot {
+		atomic<size_t> sequence;
+		T item;
+
+		Slot() : sequence(0), item() {}
+		Slot(const Slot& other) : sequence(other.sequence.load()), item(other.item) {}
+	};
+
+	vector<Slot> slots;
+	size_t mask;
+	//kept on separate cache lines so producers and consumers do not collide
+	alignas(64) atomic<size_t> head{ 0 };
+	alignas(64) atomic<size_t> tail{ 0 };
+	atomic<bool> closed{ false };
+};
+
+#endif // !BOUNDEDQUEUE_H
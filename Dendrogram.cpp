@@ -0,0 +1,215 @@
+//Dendrogram.cpp
+#include "stdafx.h"
+#include "Dendrogram.h"
+#include "Utility.h"
+#include <algorithm>
+
+//Single linkage clustering of the graph. The minimum spanning forest of
+//the neighbor edges is built once, every merge of two clusters is recorded
+//as a point in the tree along with the distance the merge happened at
+
+//gathers every edge between two non vacant neighbors and sorts them by
+//weight. Each worker collects and sorts its own slice of the nodes and
+//the sorted slices are merged together afterwards
+vector<Edge> Dendrogram::sorted_edges(const NodeColumns& columns) {
+	const char order[] = { ASCEND, DESCEND, NORTH, SOUTH, EAST, WEST };
+	vector<vector<Edge>> slices(Utility::thread_count());
+	vector<Edge> edges;
+	vector<size_t> bounds;
+	auto lighter = [](const Edge& a, const Edge& b) { return a.weight < b.weight; };
+
+	Utility::parallel_for(columns.size(), [&](size_t chunk, size_t begin, size_t end) {
+		Edge edge;
+
+		for (size_t curr = begin; curr < end; curr++) {
+			if (columns.values[curr] == VACANT) {
+				continue;
+			}
+
+			for (char direct : order) {
+				edge.to = columns.links(direct)[curr];
+
+				if (edge.to != NO_NEIGHBOR && columns.values[edge.to] != VACANT) {
+					edge.from = uint32_t(curr);
+					edge.weight = columns.distance(edge.from, edge.to);
+					slices[chunk].push_back(edge);
+				}
+			}
+		}
+		sort(slices[chunk].begin(), slices[chunk].end(), lighter);
+	});
+
+	//merge the sorted slices
+	for (vector<Edge>& slice : slices) {
+		bounds.push_back(edges.size());
+		edges.insert(edges.end(), slice.begin(), slice.end());
+	}
+
+	for (size_t i = 1; i < bounds.size(); i++) {
+		inplace_merge(edges.begin(), edges.begin() + bounds[i],
+			i + 1 < bounds.size() ? edges.begin() + bounds[i + 1] : edges.end(), lighter);
+	}
+
+	return edges;
+}
+
+//runs Kruskal's algorithm over the sorted edges. Every union that joins
+//two components adds a point to the tree above the two subtrees
+void Dendrogram::build(const NodeColumns& columns) {
+	vector<Edge> edges = sorted_edges(columns);
+	vector<uint32_t> parent(columns.size()), top(columns.size());
+	Linkage link;
+	uint32_t from, to;
+
+	leaves = columns.size();
+	edges_used = 0;
+	tree.clear();
+	tree.reserve(2 * leaves);
+
+	for (uint32_t i = 0; i < leaves; i++) {
+		parent[i] = i;
+		top[i] = i;
+
+		link.left = link.right = NO_NEIGHBOR;
+		link.height = 0;
+		tree.push_back(link);
+	}
+
+	for (Edge& edge : edges) {
+		from = find(parent, edge.from);
+		to = find(parent, edge.to);
+
+		if (from == to) {
+			continue;
+		}
+
+		link.left = top[from];
+		link.right = top[to];
+		link.height = edge.weight;
+		tree.push_back(link);
+
+		parent[to] = from;
+		top[from] = uint32_t(tree.size() - 1);
+		edges_used++;
+	}
+
+	order_leaves();
+	built = true;
+}
+
+//finds the representative of a component, halving the path along the way
+uint32_t Dendrogram::find(vector<uint32_t>& parent, uint32_t curr) {
+	while (parent[curr] != curr) {
+		parent[curr] = parent[parent[curr]];
+		curr = parent[curr];
+	}
+	return curr;
+}
+
+//lays the leaves out so that every subtree covers a contiguous range
+//of the leaf order. Done without recursion since a chain of merges can
+//be as deep as the graph is large
+void Dendrogram::order_leaves() {
+	vector<bool> has_parent(tree.size(), false);
+	vector<pair<uint32_t, bool>> stack;
+	uint32_t curr;
+
+	leaf_order.clear();
+	roots.clear();
+
+	for (size_t i = leaves; i < tree.size(); i++) {
+		has_parent[tree[i].left] = true;
+		has_parent[tree[i].right] = true;
+	}
+
+	for (uint32_t i = 0; i < tree.size(); i++) {
+		if (!has_parent[i]) {
+			roots.push_back(i);
+			stack.push_back(make_pair(i, false));
+		}
+
+		//post order walk, the bool marks a point whose children are done
+		while (!stack.empty()) {
+			curr = stack.back().first;
+
+			if (curr < leaves) {
+				tree[curr].lower = uint32_t(leaf_order.size());
+				leaf_order.push_back(curr);
+				tree[curr].upper = uint32_t(leaf_order.size());
+				stack.pop_back();
+			}
+			else if (stack.back().second) {
+				tree[curr].lower = tree[tree[curr].left].lower;
+				tree[curr].upper = tree[tree[curr].right].upper;
+				stack.pop_back();
+			}
+			else {
+				stack.back().second = true;
+				stack.push_back(make_pair(tree[curr].right, false));
+				stack.push_back(make_pair(tree[curr].left, false));
+			}
+		}
+	}
+}
+
+//returns the members of every cluster of more than one node whose nodes are
+//connected by edges no longer than dist. Only points above the cut are
+//visited so the cost follows the size of the answer
+vector<vector<uint32_t>> Dendrogram::clusters_at(const uint32_t dist) const {
+	vector<vector<uint32_t>> clusters;
+	vector<uint32_t> stack(roots);
+	uint32_t curr;
+
+	while (!stack.empty()) {
+		curr = stack.back();
+		stack.pop_back();
+
+		if (curr < leaves) {
+			continue;
+		}
+
+		if (tree[curr].height <= dist) {
+			clusters.push_back(vector<uint32_t>(leaf_order.begin() + tree[curr].lower,
+				leaf_order.begin() + tree[curr].upper));
+		}
+		else {
+			stack.push_back(tree[curr].left);
+			stack.push_back(tree[curr].right);
+		}
+	}
+
+	return clusters;
+}
+
+//number of clusters with more than one node for every distance from 0 up
+//to max_dist. The merges are already in order of distance so the whole
+//curve comes from a single pass over them
+vector<int> Dendrogram::cluster_curve(const uint32_t max_dist) const {
+	vector<int> curve(max_dist + 1, 0);
+	size_t merge = leaves;
+	int clusters = 0;
+	bool left_single, right_single;
+
+	for (uint32_t dist = 0; dist <= max_dist; dist++) {
+		while (merge < tree.size() && tree[merge].height <= dist) {
+			left_single = tree[merge].left < leaves;
+			right_single = tree[merge].right < leaves;
+
+			//two nodes form a new cluster, two clusters become one
+			if (left_single && right_single) {
+				clusters++;
+			}
+			else if (!left_single && !right_single) {
+				clusters--;
+			}
+			merge++;
+		}
+		curve[dist] = clusters;
+	}
+
+	return curve;
+}
+
+bool Dendrogram::is_built() const { return built; }
+
+size_t Dendrogram::edge_count() const { return edges_used; }
@@ -0,0 +1,41 @@
+#ifndef DENDROGRAM_H
+#define DENDROGRAM_H
+
+#include "NodeColumns.h"
+
+//an edge between two adjacent, non vacant nodes of the column store
+struct Edge {
+	uint32_t from, to, weight;
+};
+
+//a point of the single linkage tree. Leaves are the column indices of the
+//nodes themselves, every other point joins two subtrees at some distance.
+//lower and upper bound the leaves beneath it within the leaf order
+struct Linkage {
+	uint32_t left, right, height;
+	uint32_t lower, upper;
+};
+
+//single linkage hierarchy over the neighbor edges of the graph. Built once
+//with Kruskal's algorithm so that the clusters for any maximum distance can
+//be read off of the tree instead of recomputing them
+class Dendrogram {
+
+public:
+	void build(const NodeColumns&);
+	vector<vector<uint32_t>> clusters_at(const uint32_t) const;
+	vector<int> cluster_curve(const uint32_t) const;
+	bool is_built() const;
+	size_t edge_count() const;
+
+private:
+	size_t leaves = 0, edges_used = 0;
+	bool built = false;
+	vector<Linkage> tree;
+	vector<uint32_t> leaf_order, roots;
+	vector<Edge> sorted_edges(const NodeColumns&);
+	uint32_t find(vector<uint32_t>&, uint32_t);
+	void order_leaves();
+};
+
+#endif // !DENDROGRAM_H
@@ -0,0 +1,191 @@
+//DensityClustering.cpp
+#include "stdafx.h"
+#include "DensityClustering.h"
+#include "Utility.h"
+
+//Density based clustering of the graph. Neighborhoods come from box
+//queries over the z-order keys of the column store. Core readings are
+//found, joined and labeled in parallel with a lock free union find where
+//the smaller index always wins, so the result does not depend on how the
+//work was scheduled
+
+//finds the clusters for the given radius, number of readings needed for
+//a reading to be a core reading and smallest value a reading must have
+//to take part (VACANT to accept every reading). Returns false, leaving no
+//clusters, if the radius or the number of readings is not positive
+bool DensityClustering::run(const NodeColumns& columns, const double eps_radius,
+	const int min_pts, const int threshold) {
+
+	const uint32_t size = uint32_t(columns.size());
+	const size_t needed = size_t(min_pts);
+	vector<char> is_core(size, 0);
+	vector<uint32_t> label(size, NO_NEIGHBOR);
+	map<uint32_t, size_t> cluster_of;
+	map<uint32_t, size_t>::iterator found;
+
+	eps = eps_radius;
+	min_value = threshold;
+	clusters.clear();
+	noise = 0;
+	core = 0;
+
+	if (eps <= 0 || min_pts <= 0) {
+		return false;
+	}
+
+	parent = vector<atomic<uint32_t>>(size);
+
+	//find the core readings
+	Utility::parallel_for(size, [&](size_t, size_t begin, size_t end) {
+		vector<uint32_t> near;
+
+		for (uint32_t curr = uint32_t(begin); curr < end; curr++) {
+			parent[curr].store(curr);
+
+			if (eligible(columns, curr)) {
+				near.clear();
+				neighborhood(columns, curr, near);
+				is_core[curr] = near.size() >= needed;
+			}
+		}
+	});
+
+	//join core readings that are within reach of one another
+	Utility::parallel_for(size, [&](size_t, size_t begin, size_t end) {
+		vector<uint32_t> near;
+
+		for (uint32_t curr = uint32_t(begin); curr < end; curr++) {
+			if (!is_core[curr]) {
+				continue;
+			}
+
+			near.clear();
+			neighborhood(columns, curr, near);
+
+			for (uint32_t other : near) {
+				if (other > curr && is_core[other]) {
+					unite(curr, other);
+				}
+			}
+		}
+	});
+
+	//label every reading. Border readings join the cluster of the
+	//first core reading in reach, everything else is noise
+	Utility::parallel_for(size, [&](size_t, size_t begin, size_t end) {
+		vector<uint32_t> near;
+
+		for (uint32_t curr = uint32_t(begin); curr < end; curr++) {
+			if (is_core[curr]) {
+				label[curr] = find(curr);
+			}
+			else if (eligible(columns, curr)) {
+				near.clear();
+				neighborhood(columns, curr, near);
+
+				for (uint32_t other : near) {
+					if (is_core[other]) {
+						label[curr] = find(other);
+						break;
+					}
+				}
+			}
+		}
+	});
+
+	//gather the members in index order
+	for (uint32_t curr = 0; curr < size; curr++) {
+		if (label[curr] == NO_NEIGHBOR) {
+			noise += eligible(columns, curr) ? 1 : 0;
+			continue;
+		}
+
+		core += is_core[curr];
+
+		if ((found = cluster_of.find(label[curr])) == cluster_of.end()) {
+			found = cluster_of.insert(make_pair(label[curr], clusters.size())).first;
+			clusters.push_back(vector<uint32_t>());
+		}
+		clusters[found->second].push_back(curr);
+	}
+
+	parent.clear();
+	return true;
+}
+
+const vector<vector<uint32_t>>& DensityClustering::get_clusters() const { return clusters; }
+
+size_t DensityClustering::get_noise() const { return noise; }
+
+size_t DensityClustering::get_core() const { return core; }
+
+//only non vacant readings at or above the threshold take part
+bool DensityClustering::eligible(const NodeColumns& columns, uint32_t curr) const {
+	return columns.values[curr] != VACANT && columns.values[curr] >= min_value;
+}
+
+//every eligible reading within eps of the current one, itself included.
+//the box around the reading narrows things down before the exact check
+void DensityClustering::neighborhood(const NodeColumns& columns, uint32_t curr,
+	vector<uint32_t>& near) const {
+
+	const int reach = int(eps);
+	vector<uint32_t> boxed;
+	Position low, high;
+	double dx, dy, dz;
+
+	low.x = columns.x[curr] - reach; high.x = columns.x[curr] + reach;
+	low.y = columns.y[curr] - reach; high.y = columns.y[curr] + reach;
+	low.z = columns.z[curr] - reach; high.z = columns.z[curr] + reach;
+
+	columns.in_box(low, high, boxed);
+
+	for (uint32_t other : boxed) {
+		dx = columns.x[other] - columns.x[curr];
+		dy = columns.y[other] - columns.y[curr];
+		dz = columns.z[other] - columns.z[curr];
+
+		if (dx * dx + dy * dy + dz * dz <= eps * eps && eligible(columns, other)) {
+			near.push_back(other);
+		}
+	}
+}
+
+//root of the reading's set. Paths are halved as they are walked and a
+//failed halving is harmless since parents only ever point further down
+uint32_t DensityClustering::find(uint32_t curr) {
+	uint32_t next, after;
+
+	while ((next = parent[curr].load()) != curr) {
+		after = parent[next].load();
+
+		if (after != next) {
+			parent[curr].compare_exchange_weak(next, after);
+		}
+		curr = after;
+	}
+	return curr;
+}
+
+//joins two sets by hanging the larger root beneath the smaller one
+void DensityClustering::unite(uint32_t first, uint32_t second) {
+	uint32_t expected;
+
+	while (true) {
+		first = find(first);
+		second = find(second);
+
+		if (first == second) {
+			return;
+		}
+
+		if (first < second) {
+			swap(first, second);
+		}
+
+		expected = first;
+		if (parent[first].compare_exchange_strong(expected, second)) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef DENSITYCLUSTERING_H
+#define DENSITYCLUSTERING_H
+
+#include "NodeColumns.h"
+#include <atomic>
+
+//DBSCAN style clustering over the column store. Readings with at least
+//min_pts readings within eps of them are core readings, core readings
+//within eps of each other share a cluster and any other reading within
+//eps of a core reading joins that cluster. Unlike the neighbor based
+//communities a cluster can reach across a missing reading
+class DensityClustering {
+
+public:
+	bool run(const NodeColumns&, const double, const int, const int);
+	const vector<vector<uint32_t>>& get_clusters() const;
+	size_t get_noise() const;
+	size_t get_core() const;
+
+private:
+	double eps = 0;
+	int min_value = 0;
+	size_t noise = 0, core = 0;
+	vector<vector<uint32_t>> clusters;
+	vector<atomic<uint32_t>> parent;
+	bool eligible(const NodeColumns&, uint32_t) const;
+	void neighborhood(const NodeColumns&, uint32_t, vector<uint32_t>&) const;
+	uint32_t find(uint32_t);
+	void unite(uint32_t, uint32_t);
+};
+
+#endif // !DENSITYCLUSTERING_H
@@ -0,0 +1,342 @@
+//DoseGrid.cpp
+#include "stdafx.h"
+#include "DoseGrid.h"
+#include "Utility.h"
+#include <cmath>
+#include <limits>
+
+//The box covers every node of the column store, vacant ones included, so
+//a node that changes value always has a cell to patch. Where more than one
+//node shares a coordinate the cell holds a reading of one of them over a
+//vacancy. Walking a segment, t runs from 0 at its start to 1 at its end
+//and next_t holds the t at which the segment crosses into the next cell
+//along each axis. The cells of a stretch outside of the box are counted
+//as the cell boundaries it crosses, as though it never passed exactly
+//through an edge or corner
+
+//lays every node into its cell, densely if the box holds no more than
+//MAX_DOSE_CELLS cells
+void DoseGrid::build(const NodeColumns& columns) {
+	int low[3] = { INT32_MAX, INT32_MAX, INT32_MAX }, high[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+	const vector<int32_t>* axis[3] = { &columns.x, &columns.y, &columns.z };
+	long long volume = 1;
+	int at[3];
+	size_t index;
+
+	clear();
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		for (int dim = 0; dim < 3; dim++) {
+			low[dim] = min(low[dim], (*axis[dim])[i]);
+			high[dim] = max(high[dim], (*axis[dim])[i]);
+		}
+	}
+
+	for (int dim = 0; dim < 3; dim++) {
+		//nothing to hold, every cell is missing
+		if (low[dim] > high[dim]) {
+			low[dim] = high[dim] = 0;
+		}
+		origin[dim] = low[dim];
+		extent[dim] = high[dim] - low[dim] + 1;
+		volume *= extent[dim];
+	}
+
+	dense = volume <= MAX_DOSE_CELLS;
+
+	if (dense) {
+		cells.assign((size_t)volume, VACANT);
+
+		for (size_t i = 0; i < columns.size(); i++) {
+			for (int dim = 0; dim < 3; dim++) {
+				at[dim] = (*axis[dim])[i] - origin[dim];
+			}
+			index = ((size_t)at[2] * extent[1] + at[1]) * extent[0] + at[0];
+
+			if (cells[index] == VACANT) {
+				cells[index] = columns.values[i];
+			}
+		}
+	}
+	else {
+		//the columns are already in key order
+		for (size_t i = 0; i < columns.size(); i++) {
+			if (keys.empty() || keys.back() != columns.keys[i]) {
+				keys.push_back(columns.keys[i]);
+				values.push_back(columns.values[i]);
+			}
+			else if (values.back() == VACANT) {
+				values.back() = columns.values[i];
+			}
+		}
+	}
+	built = true;
+}
+
+//gives the cell of a node already laid out a new value
+void DoseGrid::patch(const Position& pos, int val) {
+	const int at[3] = { pos.x - origin[0], pos.y - origin[1], pos.z - origin[2] };
+	vector<uint64_t>::const_iterator found;
+
+	for (int dim = 0; dim < 3; dim++) {
+		if (at[dim] < 0 || at[dim] >= extent[dim]) {
+			return;
+		}
+	}
+
+	if (dense) {
+		cells[((size_t)at[2] * extent[1] + at[1]) * extent[0] + at[0]] = val;
+	}
+	else if ((found = lower_bound(keys.begin(), keys.end(), Utility::morton_encode(pos))) != keys.end() &&
+		*found == Utility::morton_encode(pos)) {
+		values[found - keys.begin()] = val;
+	}
+}
+
+//the reading of a cell, VACANT if it has none
+int DoseGrid::value_at(const int* cell) const {
+	int at[3];
+	uint64_t key;
+	vector<uint64_t>::const_iterator found;
+
+	for (int dim = 0; dim < 3; dim++) {
+		at[dim] = cell[dim] - origin[dim];
+
+		if (at[dim] < 0 || at[dim] >= extent[dim]) {
+			return VACANT;
+		}
+	}
+
+	if (dense) {
+		return cells[((size_t)at[2] * extent[1] + at[1]) * extent[0] + at[0]];
+	}
+
+	key = Utility::morton_encode(Position{ cell[0], cell[1], cell[2] });
+	found = lower_bound(keys.begin(), keys.end(), key);
+	return found != keys.end() && *found == key ? values[found - keys.begin()] : VACANT;
+}
+
+//charges a stretch of path outside of the box, length long and entering
+//the given number of new cells, none of which has a reading. False if the
+//path is given up on
+static bool charge_outside(PathDose& result, double& held, const DoseSettings& settings, const double length,
+	const unsigned long long cells) {
+	if (length <= 0) {
+		return true;
+	}
+
+	//cells is 0 when the stretch stays in the missing cell the path was
+	//already in, which reject has given up on before
+	if (settings.missing == DOSE_REJECT && cells > 0) {
+		result.cells++;
+		result.missing++;
+		result.complete = false;
+		return false;
+	}
+	else if (settings.missing == DOSE_BACKGROUND) {
+		held = settings.background;
+	}
+
+	result.cells += cells;
+	result.missing += cells;
+	result.dose += held * length;
+	result.length += length;
+	return true;
+}
+
+//the steps a straight run between two cells takes, one axis at a time
+static unsigned long long cells_between(const int* from, const int* to) {
+	unsigned long long steps = 0;
+
+	long long difference;
+
+	for (int dim = 0; dim < 3; dim++) {
+		difference = (long long)to[dim] - from[dim];
+		steps += difference < 0 ? -difference : difference;
+	}
+	return steps;
+}
+
+//the dose along the polyline through the given points
+PathDose DoseGrid::trace(const vector<PathPoint>& path, const DoseSettings& settings) const {
+	const double infinity = numeric_limits<double>::infinity();
+	PathDose result = { 0, 0, 0, 0, true, true };
+	double start[3], delta[3], next_t[3], step_t[3], t, end_t, span, enter_t, leave_t, inside, low, high, across[2];
+	double held = settings.background;
+	int cell[3], step[3], last[3] = { INT32_MIN, INT32_MIN, INT32_MIN }, from[3], to[3], axis, val;
+	unsigned long long skipped;
+
+	for (const PathPoint& point : path) {
+		if (!in_range(point)) {
+			result.complete = result.valid = false;
+			return result;
+		}
+	}
+
+	for (size_t i = 0; i + 1 < path.size(); i++) {
+		start[0] = path[i].x;
+		start[1] = path[i].y;
+		start[2] = path[i].z;
+		delta[0] = path[i + 1].x - start[0];
+		delta[1] = path[i + 1].y - start[1];
+		delta[2] = path[i + 1].z - start[2];
+		span = sqrt(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+
+		if (span == 0) {
+			continue;
+		}
+
+		//slab test: the segment is inside of the box from enter_t to
+		//leave_t, if at all
+		enter_t = 0;
+		leave_t = 1;
+
+		for (int dim = 0; dim < 3; dim++) {
+			low = origin[dim] - 0.5;
+			high = origin[dim] + extent[dim] - 0.5;
+			from[dim] = (int)floor(start[dim] + 0.5);
+			to[dim] = (int)floor(start[dim] + delta[dim] + 0.5);
+
+			if (delta[dim] != 0) {
+				across[0] = (low - start[dim]) / delta[dim];
+				across[1] = (high - start[dim]) / delta[dim];
+				enter_t = max(enter_t, min(across[0], across[1]));
+				leave_t = min(leave_t, max(across[0], across[1]));
+			}
+			else if (start[dim] < low || start[dim] > high) {
+				leave_t = -1;
+			}
+		}
+
+		//wholly outside of the box
+		if (enter_t >= leave_t) {
+			skipped = cells_between(from, to) + 1;
+
+			if (equal(from, from + 3, last)) {
+				skipped--;
+			}
+			if (!charge_outside(result, held, settings, span, skipped)) {
+				return result;
+			}
+			copy(to, to + 3, last);
+			continue;
+		}
+
+		//from here on the walk covers only the part inside of the box, its
+		//first cell kept inside for a start on the far face
+		for (int dim = 0; dim < 3; dim++) {
+			start[dim] += enter_t * delta[dim];
+			delta[dim] *= leave_t - enter_t;
+			cell[dim] = min(max((int)floor(start[dim] + 0.5), origin[dim]), origin[dim] + extent[dim] - 1);
+		}
+
+		if (enter_t > 0) {
+			skipped = cells_between(from, cell);
+
+			if (equal(from, from + 3, last)) {
+				skipped--;
+			}
+			if (!charge_outside(result, held, settings, enter_t * span, skipped)) {
+				return result;
+			}
+			copy(from, from + 3, last);
+		}
+
+		for (int dim = 0; dim < 3; dim++) {
+			if (delta[dim] > 0) {
+				step[dim] = 1;
+				next_t[dim] = (cell[dim] + 0.5 - start[dim]) / delta[dim];
+				step_t[dim] = 1 / delta[dim];
+			}
+			else if (delta[dim] < 0) {
+				step[dim] = -1;
+				next_t[dim] = (cell[dim] - 0.5 - start[dim]) / delta[dim];
+				step_t[dim] = -1 / delta[dim];
+			}
+			else {
+				step[dim] = 0;
+				next_t[dim] = step_t[dim] = infinity;
+			}
+		}
+
+		t = 0;
+		inside = (leave_t - enter_t) * span;
+
+		while (t < 1) {
+			axis = next_t[0] < next_t[1] ? (next_t[0] < next_t[2] ? 0 : 2) : (next_t[1] < next_t[2] ? 1 : 2);
+			end_t = min(next_t[axis], 1.0);
+
+			//passing exactly through an edge or corner leaves nothing
+			//inside of the cells in between
+			if (end_t > t) {
+				val = value_at(cell);
+
+				if (cell[0] != last[0] || cell[1] != last[1] || cell[2] != last[2]) {
+					result.cells++;
+					result.missing += val == VACANT;
+					copy(cell, cell + 3, last);
+				}
+
+				if (val != VACANT) {
+					held = val;
+				}
+				else if (settings.missing == DOSE_REJECT) {
+					result.complete = false;
+					return result;
+				}
+				else if (settings.missing == DOSE_BACKGROUND) {
+					held = settings.background;
+				}
+
+				result.dose += held * (end_t - t) * inside;
+				result.length += (end_t - t) * inside;
+			}
+
+			t = end_t;
+			cell[axis] += step[axis];
+			next_t[axis] += step_t[axis];
+		}
+
+		//last is the cell the walk left the box from
+		if (leave_t < 1) {
+			if (!charge_outside(result, held, settings, (1 - leave_t) * span, cells_between(last, to))) {
+				return result;
+			}
+			copy(to, to + 3, last);
+		}
+	}
+
+	return result;
+}
+
+//true if every coordinate of the point is finite and within
+//MAX_PATH_COORDINATE of the origin, so that its cell fits in an int
+bool DoseGrid::in_range(const PathPoint& point) {
+	for (double coordinate : { point.x, point.y, point.z }) {
+		if (!isfinite(coordinate) || fabs(coordinate) > MAX_PATH_COORDINATE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//the corners of the box the cells cover
+void DoseGrid::bounds(Position& low, Position& high) const {
+	low = Position{ origin[0], origin[1], origin[2] };
+	high = Position{ origin[0] + extent[0] - 1, origin[1] + extent[1] - 1, origin[2] + extent[2] - 1 };
+}
+
+bool DoseGrid::is_built() const { return built; }
+
+bool DoseGrid::is_dense() const { return dense; }
+
+size_t DoseGrid::bytes() const {
+	return cells.size() * sizeof(int) + keys.size() * sizeof(uint64_t) + values.size() * sizeof(int);
+}
+
+void DoseGrid::clear() {
+	cells.clear();
+	keys.clear();
+	values.clear();
+	built = dense = false;
+}
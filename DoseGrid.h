@@ -0,0 +1,67 @@
+#ifndef DOSEGRID_H
+#define DOSEGRID_H
+
+#include "NodeColumns.h"
+
+#define DOSE_BACKGROUND 0
+#define DOSE_HOLD 1
+#define DOSE_REJECT 2
+#define MAX_DOSE_CELLS (1 << 24)
+#define MAX_PATH_COORDINATE 1e9
+
+//a point along a path, in the same space as the resolved coordinates. Each
+//coordinate has to be finite and within MAX_PATH_COORDINATE of the origin
+struct PathPoint {
+	double x, y, z;
+};
+
+//what stands in for a cell without a reading: the background value
+//(background), the last reading the path passed through, starting from
+//the background (hold), or the path is given up on (reject)
+struct DoseSettings {
+	int missing;
+	double background;
+};
+
+//the dose taken along a path, the sum of each reading times the length of
+//path inside of its cell. cells counts the cells entered and missing those
+//without a reading. complete is false if a rejected cell ended the walk
+//and valid is false if a point of the path was out of range, in which case
+//nothing was walked
+struct PathDose {
+	double dose, length;
+	unsigned long long cells, missing;
+	bool complete, valid;
+};
+
+//the readings of the column store laid out for walking paths through. Each
+//coordinate is the center of a unit cell. When the bounding box is small
+//enough every cell gets a slot in a dense grid, otherwise the cells are
+//kept sorted by their z-order key and found by binary search. Paths are
+//walked cell by cell with the traversal of Amanatidis and Woo, which steps
+//to whichever cell boundary along x, y or z the path crosses next. Each
+//segment is first clipped to the box, as only cells inside of it can hold
+//a reading, and what lies outside is charged as missing cells all at once
+class DoseGrid {
+
+public:
+	void build(const NodeColumns&);
+	void patch(const Position&, int);
+	PathDose trace(const vector<PathPoint>&, const DoseSettings&) const;
+	int value_at(const int*) const;
+	static bool in_range(const PathPoint&);
+	void bounds(Position&, Position&) const;
+	bool is_built() const;
+	bool is_dense() const;
+	size_t bytes() const;
+	void clear();
+
+private:
+	int origin[3] = { 0, 0, 0 }, extent[3] = { 0, 0, 0 };
+	bool built = false, dense = false;
+	vector<int> cells;
+	vector<uint64_t> keys;
+	vector<int> values;
+};
+
+#endif // !DOSEGRID_H
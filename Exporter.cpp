@@ -0,0 +1,241 @@
+//Exporter.cpp
+#include "stdafx.h"
+#include "Exporter.h"
+#include "Utility.h"
+#include <fstream>
+
+//Bulk export of the graph. Coordinates are written already resolved to
+//x,y,z and neighbors, when asked for, as indices into the same listing
+//(-1 when there is none). The binary layout is the magic, a version, the
+//node count and a flag for neighbors, all 32 bit little endian, followed by
+//x, y, z and value per node and the six neighbor indices if flagged
+
+//writes the columns in the given format. Returns false if the file
+//could not be opened
+bool Exporter::write(const NodeColumns& columns, const string& path, const int format,
+	const bool edges) {
+
+	vector<char> buffer(EXPORT_BUFFER);
+	ofstream out;
+
+	out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	out.open(path, ios::out | ios::binary | ios::trunc);
+
+	if (!out.is_open()) {
+		return false;
+	}
+
+	switch (format) {
+	case EXPORT_CSV:
+		write_csv(columns, out, edges);
+		break;
+	case EXPORT_BINARY:
+		write_binary(columns, out, edges);
+		break;
+	default:
+		write_vtk(columns, out, edges);
+		break;
+	}
+
+	out.close();
+	return !out.fail();
+}
+
+//one line per node, x,y,z,value then the six neighbors in the order
+//north, south, east, west, ascend, descend
+void Exporter::write_csv(const NodeColumns& columns, ostream& out, const bool edges) {
+	const vector<uint32_t>* links[] = { &columns.north, &columns.south, &columns.east,
+		&columns.west, &columns.ascend, &columns.descend };
+
+	out << (edges ? "x,y,z,value,north,south,east,west,ascend,descend\n" : "x,y,z,value\n");
+
+	write_chunked(columns.size(), out, [&](string& text, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			append_int(text, columns.x[i]);
+			text.push_back(',');
+			append_int(text, columns.y[i]);
+			text.push_back(',');
+			append_int(text, columns.z[i]);
+			text.push_back(',');
+			append_int(text, columns.values[i]);
+
+			if (edges) {
+				for (const vector<uint32_t>* link : links) {
+					text.push_back(',');
+					append_int(text, (*link)[i] == NO_NEIGHBOR ? -1 : (long long)(*link)[i]);
+				}
+			}
+			text.push_back('\n');
+		}
+	});
+}
+
+//see the layout at the top of the file
+void Exporter::write_binary(const NodeColumns& columns, ostream& out, const bool edges) {
+	const vector<uint32_t>* links[] = { &columns.north, &columns.south, &columns.east,
+		&columns.west, &columns.ascend, &columns.descend };
+	string header(EXPORT_MAGIC);
+
+	append_raw(header, 1);
+	append_raw(header, uint32_t(columns.size()));
+	append_raw(header, edges ? 1 : 0);
+	out.write(header.data(), header.size());
+
+	write_chunked(columns.size(), out, [&](string& bytes, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			append_raw(bytes, uint32_t(columns.x[i]));
+			append_raw(bytes, uint32_t(columns.y[i]));
+			append_raw(bytes, uint32_t(columns.z[i]));
+			append_raw(bytes, uint32_t(columns.values[i]));
+
+			if (edges) {
+				for (const vector<uint32_t>* link : links) {
+					append_raw(bytes, (*link)[i]);
+				}
+			}
+		}
+	});
+}
+
+//legacy ASCII VTK polydata. Every node is a point carrying its value and
+//each linked pair of nodes becomes a line between two points
+void Exporter::write_vtk(const NodeColumns& columns, ostream& out, const bool edges) {
+	const vector<uint32_t>* links[] = { &columns.north, &columns.south, &columns.east,
+		&columns.west, &columns.ascend, &columns.descend };
+	size_t lines = 0;
+
+	out << "# vtk DataFile Version 3.0\nRadiation graph\nASCII\nDATASET POLYDATA\n";
+	out << "POINTS " << columns.size() << " int\n";
+
+	write_chunked(columns.size(), out, [&](string& text, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			append_int(text, columns.x[i]);
+			text.push_back(' ');
+			append_int(text, columns.y[i]);
+			text.push_back(' ');
+			append_int(text, columns.z[i]);
+			text.push_back('\n');
+		}
+	});
+
+	//each linked pair is listed once, see lists_edge
+	if (edges) {
+		for (size_t i = 0; i < columns.size(); i++) {
+			for (size_t direction = 0; direction < 6; direction++) {
+				lines += lists_edge(links, i, direction);
+			}
+		}
+
+		out << "LINES " << lines << " " << 3 * lines << "\n";
+
+		write_chunked(columns.size(), out, [&](string& text, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				for (size_t direction = 0; direction < 6; direction++) {
+					if (lists_edge(links, i, direction)) {
+						text.append("2 ");
+						append_int(text, (long long)i);
+						text.push_back(' ');
+						append_int(text, (*links[direction])[i]);
+						text.push_back('\n');
+					}
+				}
+			}
+		});
+	}
+
+	out << "POINT_DATA " << columns.size() << "\nSCALARS value int 1\nLOOKUP_TABLE default\n";
+
+	write_chunked(columns.size(), out, [&](string& text, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			append_int(text, columns.values[i]);
+			text.push_back('\n');
+		}
+	});
+}
+
+//whether the link of node i in the given direction is the one that lists
+//the pair as a line. Links are not always mutual, so a pair is listed from
+//its lower index when that end links back and otherwise from whichever end
+//holds the link, and only through the first direction that reaches it
+bool Exporter::lists_edge(const vector<uint32_t>* const* links, size_t i, size_t direction) {
+	const uint32_t other = (*links[direction])[i];
+
+	if (other == NO_NEIGHBOR || other == i) {
+		return false;
+	}
+
+	for (size_t earlier = 0; earlier < direction; earlier++) {
+		if ((*links[earlier])[i] == other) {
+			return false;
+		}
+	}
+
+	if (other > i) {
+		return true;
+	}
+
+	for (size_t back = 0; back < 6; back++) {
+		if ((*links[back])[other] == i) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//formats [0, count) in chunks of EXPORT_CHUNK nodes. A batch of one chunk
+//per worker is formatted in parallel and then written out in order
+void Exporter::write_chunked(size_t count, ostream& out,
+	const function<void(string&, size_t, size_t)>& format) {
+
+	const size_t batch = Utility::thread_count();
+	vector<string> chunks(batch);
+	size_t start, chunk_count;
+
+	for (start = 0; start < count; start += batch * EXPORT_CHUNK) {
+		chunk_count = min(batch, (count - start + EXPORT_CHUNK - 1) / EXPORT_CHUNK);
+
+		Utility::parallel_for(chunk_count * EXPORT_CHUNK, [&](size_t, size_t begin, size_t end) {
+			size_t first, last;
+
+			//every chunk starting in [begin, end) belongs to this worker
+			for (size_t chunk = (begin + EXPORT_CHUNK - 1) / EXPORT_CHUNK;
+				chunk * EXPORT_CHUNK < end; chunk++) {
+				first = start + chunk * EXPORT_CHUNK;
+				last = min(first + EXPORT_CHUNK, count);
+
+				chunks[chunk].clear();
+				format(chunks[chunk], first, last);
+			}
+		});
+
+		for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+			out.write(chunks[chunk].data(), chunks[chunk].size());
+		}
+	}
+}
+
+//appends the decimal digits of an integer
+void Exporter::append_int(string& text, long long val) {
+	char digits[24];
+	int length = 0;
+	unsigned long long magnitude = val < 0 ? 0ULL - (unsigned long long)val : val;
+
+	do {
+		digits[length++] = char('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (val < 0) {
+		text.push_back('-');
+	}
+	while (length > 0) {
+		text.push_back(digits[--length]);
+	}
+}
+
+//appends a 32 bit integer in little endian byte order
+void Exporter::append_raw(string& bytes, uint32_t val) {
+	for (int shift = 0; shift < 32; shift += 8) {
+		bytes.push_back(char((val >> shift) & 0xff));
+	}
+}
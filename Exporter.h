@@ -0,0 +1,35 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "NodeColumns.h"
+#include <string>
+#include <functional>
+
+#define EXPORT_CSV 1
+#define EXPORT_BINARY 2
+#define EXPORT_VTK 3
+#define EXPORT_CHUNK 65536
+#define EXPORT_BUFFER (1 << 20)
+#define EXPORT_MAGIC "RPLG"
+
+//writes the column store out to a file as CSV, a packed binary layout or
+//VTK legacy point data. Nodes are formatted in chunks by the workers and
+//each batch of chunks is written in order before the next one is
+//formatted, so only a batch is ever held in memory
+class Exporter {
+	public:
+		static bool write(const NodeColumns&, const string&, const int, const bool);
+		static void append_int(string&, long long);
+		static void append_raw(string&, uint32_t);
+
+	private:
+		Exporter() {};
+		static void write_csv(const NodeColumns&, ostream&, const bool);
+		static void write_binary(const NodeColumns&, ostream&, const bool);
+		static void write_vtk(const NodeColumns&, ostream&, const bool);
+		static bool lists_edge(const vector<uint32_t>* const*, size_t, size_t);
+		static void write_chunked(size_t, ostream&,
+			const function<void(string&, size_t, size_t)>&);
+};
+
+#endif // !EXPORTER_H
@@ -0,0 +1,682 @@
+//GraphServer.cpp
+#include "stdafx.h"
+#include "GraphServer.h"
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+#pragma comment(lib, "Ws2_32.lib")
+#define poll WSAPoll
+#define close_socket closesocket
+#define SEND_FLAGS 0
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+//A single threaded poll loop owns the graph, so requests from different
+//clients never run at the same time and the graph needs no locking.
+//Each pass reads whatever every ready client sent, answers every complete
+//line in it and writes back as much as the socket takes. A client whose
+//answers pile up past SERVER_OUTPUT_LIMIT is not read from again until
+//it catches up
+
+//the menu options by name, numbered as in execute.cpp
+static const map<string, int> OPTIONS = {
+	{ "ADD", 1 }, { "DELETE", 2 }, { "SIZE", 3 }, { "DISPLAY", 4 }, { "CLUSTERS", 5 },
+	{ "HISTOGRAM", 6 }, { "EXIT", 7 }, { "DEFRAGMENT", 8 }, { "CLUSTER_SWEEP", 9 },
+	{ "DENSITY_CLUSTERS", 10 }, { "REGION_TOTALS", 11 }, { "REGION_SUMMARY", 12 },
+	{ "TRENDS", 13 }, { "CHANNELS", 14 }, { "EXPORT", 15 }, { "HOTTEST", 18 },
+	{ "VALUE_RANGE", 19 }, { "APPROXIMATE", 22 }, { "CLUSTER_SUMMARY", 23 }, { "DOSE_PATH", 24 },
+	{ "ISOSURFACE", 25 }
+};
+
+//true when the last socket call failed only because it would have blocked
+static bool would_block() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static void set_nonblocking(socket_t socket) {
+#ifdef _WIN32
+	u_long on = 1;
+	ioctlsocket(socket, FIONBIO, &on);
+#else
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+//small requests go out as soon as they are written
+static void set_nodelay(socket_t socket) {
+	int on = 1;
+
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+//writes all of a message to a blocking socket, which may take it in
+//several parts. Returns false if the connection failed
+static bool send_all(socket_t socket, const string& message) {
+	size_t written = 0;
+	long sent;
+
+	while (written < message.size()) {
+		sent = send(socket, message.data() + written,
+			(int)min(message.size() - written, (size_t)SERVER_READ_SIZE), SEND_FLAGS);
+
+		if (sent <= 0) {
+			return false;
+		}
+		written += sent;
+	}
+	return true;
+}
+
+GraphServer::GraphServer(RadiationGraph* graph, bool allow_shutdown) : graph(graph), listener(INVALID_SOCKET),
+	allow_shutdown(allow_shutdown) {
+#ifdef _WIN32
+	WSADATA data;
+	WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+}
+
+GraphServer::~GraphServer() {
+	for (ServerSession& session : sessions) {
+		close_socket(session.socket);
+	}
+
+	if (listener != INVALID_SOCKET) {
+		close_socket(listener);
+	}
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+//binds to the port on the loopback address only
+bool GraphServer::listen_on(unsigned short port) {
+	sockaddr_in address = {};
+	int on = 1;
+
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (listener == INVALID_SOCKET) {
+		cerr << "Error: Could not create a socket" << endl;
+		return false;
+	}
+
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listener, SERVER_BACKLOG) != 0) {
+		cerr << "Error: Could not listen on port " << port << endl;
+		return false;
+	}
+
+	set_nonblocking(listener);
+	cout << "Serving the graph on 127.0.0.1:" << port << endl;
+	return true;
+}
+
+//runs until a client sends SHUTDOWN, where that is allowed, or the
+//process is stopped
+void GraphServer::run() {
+	vector<pollfd> polled;
+	pollfd entry;
+	size_t i;
+
+	running = true;
+
+	while (running) {
+		polled.clear();
+		entry.fd = listener;
+		entry.events = POLLIN;
+		entry.revents = 0;
+		polled.push_back(entry);
+
+		for (ServerSession& session : sessions) {
+			entry.fd = session.socket;
+			entry.events = session.out.size() < SERVER_OUTPUT_LIMIT ? POLLIN : 0;
+
+			if (!session.out.empty()) {
+				entry.events |= POLLOUT;
+			}
+			polled.push_back(entry);
+		}
+
+		if (poll(polled.data(), (unsigned long)polled.size(), SERVER_POLL_MS) <= 0) {
+			continue;
+		}
+
+		//sessions are matched up by position, new ones are only added after
+		for (i = 0; i < sessions.size(); i++) {
+			short ready = polled[i + 1].revents;
+
+			//lines that came in ahead of a hang up are still answered
+			if (ready & (POLLIN | POLLHUP | POLLERR)) {
+				bool open = read_session(sessions[i]);
+
+				process(sessions[i]);
+				sessions[i].closing |= !open;
+			}
+
+			if (!sessions[i].out.empty() && !write_session(sessions[i])) {
+				sessions[i].out.clear();
+				sessions[i].closing = true;
+			}
+		}
+
+		//closed sessions leave once everything owed to them is written
+		for (i = sessions.size(); i-- > 0;) {
+			if (sessions[i].closing && sessions[i].out.empty()) {
+				close_socket(sessions[i].socket);
+				sessions.erase(sessions.begin() + i);
+			}
+		}
+
+		if (polled[0].revents & POLLIN) {
+			accept_clients();
+		}
+	}
+
+	cout << "Server stopped after " << requests << " requests" << endl;
+}
+
+void GraphServer::accept_clients() {
+	ServerSession session;
+	socket_t client;
+
+	while ((client = accept(listener, nullptr, nullptr)) != INVALID_SOCKET) {
+		set_nonblocking(client);
+		set_nodelay(client);
+		session.socket = client;
+		sessions.push_back(session);
+	}
+}
+
+//reads everything the client has sent so far. Returns false once the
+//client has gone away
+bool GraphServer::read_session(ServerSession& session) {
+	char buffer[SERVER_READ_SIZE];
+	long received;
+
+	while ((received = recv(session.socket, buffer, sizeof(buffer), 0)) > 0) {
+		session.in.append(buffer, received);
+
+		if (session.out.size() >= SERVER_OUTPUT_LIMIT) {
+			return true;
+		}
+	}
+
+	return received < 0 && would_block();
+}
+
+//writes as much of the pending answers as the socket will take. Returns
+//false if the connection broke
+bool GraphServer::write_session(ServerSession& session) {
+	size_t written = 0;
+	long sent;
+
+	while (written < session.out.size()) {
+		sent = send(session.socket, session.out.data() + written,
+			(int)min(session.out.size() - written, (size_t)SERVER_READ_SIZE), SEND_FLAGS);
+
+		if (sent <= 0) {
+			break;
+		}
+		written += sent;
+	}
+
+	session.out.erase(0, written);
+	return written > 0 || session.out.empty() || would_block();
+}
+
+//answers every complete line received so far
+void GraphServer::process(ServerSession& session) {
+	size_t start = 0, end;
+	string line;
+
+	while (!session.closing && (end = session.in.find('\n', start)) != string::npos) {
+		line = session.in.substr(start, end - start);
+		start = end + 1;
+
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		execute(session, line);
+	}
+
+	session.in.erase(0, start);
+}
+
+//runs one line with everything it prints captured into the answer
+void GraphServer::execute(ServerSession& session, const string& line) {
+	istringstream args(line);
+	ostringstream captured;
+	streambuf *out = cout.rdbuf(), *err = cerr.rdbuf();
+	string command;
+	bool valid, in_batch = session.batch_left > 0;
+
+	//lines inside of a batch are coordinates to add
+	if (in_batch) {
+		command = "ADD";
+	}
+	else if (!(args >> command)) {
+		return;
+	}
+
+	boost::to_upper(command);
+	requests++;
+
+	cout.rdbuf(captured.rdbuf());
+	cerr.rdbuf(captured.rdbuf());
+
+	try {
+		valid = dispatch(command, args, session);
+	}
+	catch (exception& error) {
+		captured.str("");
+		captured << error.what();
+		valid = false;
+	}
+
+	cout.rdbuf(out);
+	cerr.rdbuf(err);
+
+	//a batch is answered once, after its last line
+	if (in_batch) {
+		session.batch_output += captured.str();
+
+		if (--session.batch_left == 0) {
+			session.out += "OK " + to_string(session.batch_output.size()) + "\n" + session.batch_output;
+			session.batch_output.clear();
+		}
+	}
+	else if (!valid) {
+		session.out += "ERR " + to_string(captured.str().size()) + "\n" + captured.str();
+	}
+	else if (session.batch_left == 0) {
+		session.out += "OK " + to_string(captured.str().size()) + "\n" + captured.str();
+	}
+}
+
+//performs the option. Returns false, with the reason printed, if the
+//request could not be understood
+bool GraphServer::dispatch(const string& command, istream& args, ServerSession& session) {
+	auto named = OPTIONS.find(command);
+	int option, first = 0, second = 0, third = 0;
+	double radius = 0;
+	bool edges, restricted;
+	string text;
+	Position low, high;
+	vector<double> weights;
+	DoseSettings settings = { DOSE_BACKGROUND, 0 };
+	vector<PathPoint> path;
+	PathPoint point;
+
+	if (command == "BATCH") {
+		if (!(args >> session.batch_left) || session.batch_left == 0) {
+			session.batch_left = 0;
+			cout << "BATCH needs a count";
+			return false;
+		}
+		return true;
+	}
+	if (command == "SHUTDOWN") {
+		if (!allow_shutdown) {
+			cout << "SHUTDOWN is only taken by a server started with --allow-shutdown";
+			return false;
+		}
+		running = false;
+		return true;
+	}
+
+	if (named != OPTIONS.end()) {
+		option = named->second;
+	}
+	else if (!(istringstream(command) >> option)) {
+		cout << "unknown command " << command;
+		return false;
+	}
+
+	switch (option) {
+	case 1:
+	case 2:
+		if (!(args >> text)) {
+			cout << "missing coordinates";
+			return false;
+		}
+
+		boost::to_upper(text);
+		option == 1 ? graph->add(&text) : graph->remove(&text);
+		break;
+	case 3:
+		cout << "There were " << graph->getSize() << " total nodes added to the graph" <<
+			" with " << graph->explicit_size() << " being empty" << endl;
+		break;
+	case 4:
+		args >> first;
+		graph->display(first == 2 ? 2 : 1);
+		break;
+	case 5:
+		args >> first;
+		graph->print_cluster(first);
+		break;
+	case 6:
+		graph->display_histogram();
+		break;
+	case 7:
+		session.closing = true;
+		break;
+	case 8:
+		graph->defragment();
+		break;
+	case 9:
+		//the curve holds a count for every distance up to the first
+		if (!(args >> first) || first <= 0 || first > SERVER_SWEEP_LIMIT) {
+			cout << "CLUSTER_SWEEP needs a largest distance from 1 to " << SERVER_SWEEP_LIMIT;
+			return false;
+		}
+		args >> second;
+		graph->print_cluster_sweep(first, second);
+		break;
+	case 10:
+		args >> radius >> first >> second;
+		graph->print_density_clusters(radius, first, second);
+		break;
+	case 11:
+		args >> low.x >> low.y >> low.z >> high.x >> high.y >> high.z;
+		graph->print_region_totals(low, high);
+		break;
+	case 12:
+		args >> first >> low.x >> low.y >> low.z >> high.x >> high.y >> high.z;
+		graph->print_pyramid(first, low, high);
+		break;
+	case 13:
+		if (!graph->is_recording_history()) {
+			graph->set_history(true);
+		}
+		else if (args >> radius) {
+			radius < 0 ? graph->set_history(false) : graph->print_trends(radius);
+		}
+		break;
+	case 14:
+		weights.assign(graph->get_channel_count(), 0);
+
+		for (double& weight : weights) {
+			args >> weight;
+		}
+		graph->set_channel_mix(weights);
+		break;
+	case 15:
+		args >> first >> text;
+		edges = text == "Y" || text == "y";
+
+		if (!(args >> text) || first < EXPORT_CSV || first > EXPORT_VTK) {
+			cout << "EXPORT needs a format, Y or N and a file";
+			return false;
+		}
+		if (!output_path(text, text)) {
+			return false;
+		}
+		graph->export_graph(text, first, edges);
+		break;
+	case 18:
+		//the corners are optional
+		args >> first;
+		restricted = (bool)(args >> low.x >> low.y >> low.z >> high.x >> high.y >> high.z);
+		graph->print_top_k(max(first, 0), restricted, low, high);
+		break;
+	case 19:
+		if (!(args >> first >> second)) {
+			cout << "VALUE_RANGE needs the smallest and largest value";
+			return false;
+		}
+
+		//the distance to cluster by is optional
+		if (args >> third && third > 0) {
+			graph->print_cluster_within(third, first, second);
+		}
+		else {
+			graph->print_readings_between(first, second);
+		}
+		break;
+	case 22:
+		graph->print_approximate_stats();
+		break;
+	case 23:
+		args >> first;
+		graph->print_cluster_summary(first);
+		break;
+	case 24:
+		//the policy and background, then x y z for each point
+		args >> settings.missing >> settings.background;
+
+		while (args >> point.x >> point.y >> point.z) {
+			if (!DoseGrid::in_range(point)) {
+				cout << "DOSE_PATH coordinates have to be finite and within " << MAX_PATH_COORDINATE <<
+					" of the origin";
+				return false;
+			}
+			path.push_back(point);
+		}
+		graph->print_dose_along_path(path, settings);
+		break;
+	case 25:
+		args >> radius >> first >> text;
+
+		if (text.empty() || first < MESH_PLY || first > MESH_OBJ) {
+			cout << "ISOSURFACE needs a threshold, a format and a file";
+			return false;
+		}
+		if (!output_path(text, text)) {
+			return false;
+		}
+		graph->export_isosurface(radius, text, first);
+		break;
+	default:
+		cout << "unknown option " << option;
+		return false;
+	}
+
+	return true;
+}
+
+//where a file a client names is written: inside of SERVER_OUTPUT_DIR,
+//made if need be. The name may only hold letters, digits, '_', '-' and
+//'.', and may not start with '.', so it cannot lead out of the directory.
+//Returns false, with the reason printed, if the name is turned down
+bool GraphServer::output_path(const string& name, string& path) {
+	boost::system::error_code error;
+	auto allowed = [](char c) { return isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.'; };
+
+	if (name.empty() || name.size() > SERVER_NAME_LIMIT || name[0] == '.' ||
+		!all_of(name.begin(), name.end(), allowed)) {
+		cout << "Files are named without a directory, in letters, digits, '_', '-' and '.'";
+		return false;
+	}
+
+	boost::filesystem::create_directories(SERVER_OUTPUT_DIR, error);
+
+	if (error) {
+		cout << "Could not make " << SERVER_OUTPUT_DIR;
+		return false;
+	}
+
+	path = (boost::filesystem::path(SERVER_OUTPUT_DIR) / name).string();
+	return true;
+}
+
+//connects the given number of clients and has each of them send its
+//share of the requests, LOAD_PIPELINE_DEPTH at a time without waiting for
+//the answers. Every request is an overwrite within a grid that is laid
+//down first, batched when batch is above one. Reports the throughput and
+//latency seen by the clients
+void GraphServer::load_test(const string& host, unsigned short port, int clients, int total,
+	int batch) {
+
+	const int grid[3] = { 4, 16, 32 };
+	vector<vector<double>> latencies(max(clients, 1));
+	vector<thread> workers;
+	vector<double> merged;
+	sockaddr_in address = {};
+	string seed;
+	atomic<bool> failed(false);
+
+#ifdef _WIN32
+	WSADATA data;
+	WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+	batch = max(batch, 1);
+	clients = max(clients, 1);
+
+	//coordinate i of the grid, laid down in the order the graph needs
+	auto coordinate = [&](int i) {
+		return "A" + to_string(i / (grid[1] * grid[2]) + 1) + "N" + to_string(i / grid[2] % grid[1] + 1) +
+			"E" + to_string(i % grid[2] + 1);
+	};
+
+	//sends every request, collects every answer and returns false if the
+	//connection failed on the way
+	auto session = [&](int requests, const function<string(int)>& request, vector<double>* times) {
+		socket_t client = socket(AF_INET, SOCK_STREAM, 0);
+		vector<chrono::high_resolution_clock::time_point> sent(requests);
+		char buffer[SERVER_READ_SIZE];
+		string pending, message;
+		size_t line, length;
+		long received;
+		int next = 0, answered = 0;
+
+		if (client == INVALID_SOCKET || connect(client, (sockaddr*)&address, sizeof(address)) != 0) {
+			if (client != INVALID_SOCKET) {
+				close_socket(client);
+			}
+			return false;
+		}
+		set_nodelay(client);
+
+		while (answered < requests) {
+			while (next < requests && next - answered < LOAD_PIPELINE_DEPTH) {
+				message = request(next);
+				sent[next++] = chrono::high_resolution_clock::now();
+
+				if (!send_all(client, message)) {
+					close_socket(client);
+					return false;
+				}
+			}
+
+			if ((received = recv(client, buffer, sizeof(buffer), 0)) <= 0) {
+				close_socket(client);
+				return false;
+			}
+			pending.append(buffer, received);
+
+			//answers are "OK <bytes>" or "ERR <bytes>" and then the bytes
+			while ((line = pending.find('\n')) != string::npos) {
+				length = stoul(pending.substr(pending.find(' ') + 1, line - pending.find(' ') - 1));
+
+				if (pending.size() < line + 1 + length) {
+					break;
+				}
+				pending.erase(0, line + 1 + length);
+
+				if (times != nullptr) {
+					times->push_back(chrono::duration<double, milli>(
+						chrono::high_resolution_clock::now() - sent[answered]).count());
+				}
+				answered++;
+			}
+		}
+
+		close_socket(client);
+		return true;
+	};
+
+	//the grid goes down in a single batch before the clock starts
+	seed = "BATCH " + to_string(grid[0] * grid[1] * grid[2]) + "\n";
+
+	for (int i = 0; i < grid[0] * grid[1] * grid[2]; i++) {
+		seed += coordinate(i) + "-0\n";
+	}
+
+	if (!session(1, [&](int) { return seed; }, nullptr)) {
+		cerr << "Error: Could not connect to " << host << ":" << port << endl;
+		return;
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+
+	for (int c = 0; c < clients; c++) {
+		workers.push_back(thread([&, c]() {
+			int share = total / clients + (c < total % clients);
+
+			bool completed = session(share, [&, c](int i) {
+				string message = batch > 1 ? "BATCH " + to_string(batch) + "\n" : "ADD ";
+
+				for (int b = 0; b < batch; b++) {
+					message += coordinate(((i * batch + b) * 7919 + c * 104729) %
+						(grid[0] * grid[1] * grid[2])) + "-" + to_string((i + b + c) % 100) + "\n";
+				}
+				return message;
+			}, &latencies[c]);
+
+			if (!completed) {
+				failed = true;
+			}
+		}));
+	}
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	double elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	for (vector<double>& times : latencies) {
+		merged.insert(merged.end(), times.begin(), times.end());
+	}
+	sort(merged.begin(), merged.end());
+
+	if (failed) {
+		cerr << "Error: A client lost its connection, the figures cover what was answered" << endl;
+	}
+	if (merged.empty()) {
+		return;
+	}
+
+	cout << merged.size() << " requests (" << merged.size() * batch << " readings) from " << clients <<
+		" clients in " << elapsed << " s" << endl;
+	cout << merged.size() / elapsed << " requests/s, " << merged.size() * batch / elapsed <<
+		" readings/s" << endl;
+	cout << "Latency p50 " << merged[merged.size() / 2] << " ms, p99 " <<
+		merged[min(merged.size() - 1, merged.size() * 99 / 100)] << " ms, max " << merged.back() <<
+		" ms" << endl;
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
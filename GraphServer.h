@@ -0,0 +1,71 @@
+#ifndef GRAPHSERVER_H
+#define GRAPHSERVER_H
+
+#include "radiationgraph.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#else
+#include <poll.h>
+typedef int socket_t;
+#endif
+
+#define SERVER_BACKLOG 64
+#define SERVER_READ_SIZE 65536
+#define SERVER_OUTPUT_LIMIT (4 << 20)
+#define SERVER_POLL_MS 1000
+#define LOAD_PIPELINE_DEPTH 32
+#define SERVER_OUTPUT_DIR "server_output"
+#define SERVER_NAME_LIMIT 128
+#define SERVER_SWEEP_LIMIT 10000
+
+//one connected client. Requests are read into in and answered into out
+//in the order they arrived, so a client may send many without waiting
+struct ServerSession {
+	socket_t socket;
+	string in, out, batch_output;
+	size_t batch_left = 0;
+	bool closing = false;
+};
+
+//serves a single graph to any number of local clients over loopback TCP.
+//Each request is one line, the menu option by name or number followed by
+//whatever the menu would have prompted for, e.g. "ADD A1N1E1-5" or
+//"11 0 0 0 4 4 4". Everything the option prints comes back as
+//"OK <bytes>" and then the bytes, and why a request could not be understood
+//as "ERR <bytes>" and then the bytes.
+//"BATCH n" takes the next n lines as coordinates to add and answers once.
+//
+//Any local client may connect, so a client may not choose where the server
+//writes. EXPORT and ISOSURFACE take a bare file name and write it into
+//SERVER_OUTPUT_DIR under the directory the server was started from.
+//SHUTDOWN would stop the server for every client and is turned down unless
+//the server was started with shutdown allowed
+class GraphServer {
+
+public:
+	GraphServer(RadiationGraph*, bool);
+	~GraphServer();
+	bool listen_on(unsigned short);
+	void run();
+	static void load_test(const string&, unsigned short, int, int, int);
+
+private:
+	RadiationGraph* graph;
+	socket_t listener;
+	vector<ServerSession> sessions;
+	bool running = false, allow_shutdown;
+	unsigned long long requests = 0;
+
+	void accept_clients();
+	bool read_session(ServerSession&);
+	bool write_session(ServerSession&);
+	void process(ServerSession&);
+	void execute(ServerSession&, const string&);
+	bool dispatch(const string&, istream&, ServerSession&);
+	static bool output_path(const string&, string&);
+};
+
+#endif // !GRAPHSERVER_H
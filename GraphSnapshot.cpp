@@ -0,0 +1,188 @@
+//GraphSnapshot.cpp
+#include "stdafx.h"
+#include "GraphSnapshot.h"
+#include "Utility.h"
+#include <chrono>
+#include <algorithm>
+
+//Readings are found by slot, the order the nodes joined the live graph in.
+//Finding one by coordinate takes a lookup table that is only built the
+//first time the snapshot is changed, so taking and reading snapshots never
+//pays for it. Changes never move a coordinate, so the table is shared by
+//every copy made after it was built. Only coordinates already in the
+//snapshot can be changed since placing a new one means rewiring its
+//neighbors, which is the live graph's job
+
+GraphSnapshot::GraphSnapshot() {}
+
+GraphSnapshot::GraphSnapshot(const VersionedStore& version) : store(version) {}
+
+size_t GraphSnapshot::size() const { return store.size(); }
+
+//the number of vacant nodes
+int GraphSnapshot::explicit_size() const {
+	int empty_nodes = 0;
+
+	for (size_t slot = 0; slot < store.size(); slot++) {
+		empty_nodes += store.get(slot).value == VACANT;
+	}
+	return empty_nodes;
+}
+
+const VersionedReading& GraphSnapshot::reading(uint32_t slot) const { return store.get(slot); }
+
+//the slot of a coordinate under any of its spellings
+bool GraphSnapshot::find(const string& coordinate, uint32_t& slot) {
+	unordered_map<string, uint32_t>::const_iterator found;
+
+	if (lookup == nullptr) {
+		auto table = make_shared<unordered_map<string, uint32_t>>();
+
+		table->reserve(store.size());
+
+		for (size_t i = 0; i < store.size(); i++) {
+			(*table)[store.get(i).coordinate] = (uint32_t)i;
+		}
+		lookup = table;
+	}
+
+	if ((found = lookup->find(coordinate)) != lookup->end()) {
+		slot = found->second;
+		return true;
+	}
+
+	for (const string& perm : Utility::permutations(coordinate)) {
+		if ((found = lookup->find(perm)) != lookup->end()) {
+			slot = found->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+//gives a coordinate of the snapshot a hypothetical reading, written as it
+//would be added to the graph (ex. A2W2N5-45). Returns false if the reading
+//is malformed or the coordinate is not in the snapshot
+bool GraphSnapshot::set_reading(const string& command) {
+	size_t dash = command.find('-');
+	uint32_t slot;
+	int val;
+
+	if (dash == string::npos || dash + 1 >= command.size() || !isdigit(command[dash + 1])) {
+		return false;
+	}
+
+	val = atoi(command.c_str() + dash + 1);
+
+	if (!find(command.substr(0, dash), slot)) {
+		return false;
+	}
+	store.edit(slot).value = val;
+	return true;
+}
+
+//marks a coordinate of the snapshot as vacant
+bool GraphSnapshot::remove(const string& coordinate) {
+	uint32_t slot;
+
+	if (!find(coordinate, slot)) {
+		return false;
+	}
+	store.edit(slot).value = VACANT;
+	return true;
+}
+
+//the clusters of the snapshot by the same rule as the graph's: readings
+//join through links no further than dist away, whichever end holds the
+//link, vacant nodes joining nothing. Components are found with union-find,
+//each keeping its lowest slot as its root, so every cluster is listed once
+//in slot order of its first member
+vector<vector<uint32_t>> GraphSnapshot::clusters(const int dist) const {
+	vector<vector<uint32_t>> found;
+	vector<uint32_t> parent(store.size()), cluster(store.size(), NO_NEIGHBOR);
+	const VersionedReading* curr, *next;
+	uint32_t from, to;
+
+	auto root = [&](uint32_t at) {
+		while (parent[at] != at) {
+			parent[at] = parent[parent[at]];
+			at = parent[at];
+		}
+		return at;
+	};
+
+	if (dist <= 0) {
+		return found;
+	}
+
+	for (uint32_t slot = 0; slot < store.size(); slot++) {
+		parent[slot] = slot;
+	}
+
+	for (uint32_t slot = 0; slot < store.size(); slot++) {
+		curr = &store.get(slot);
+
+		if (curr->value == VACANT) {
+			continue;
+		}
+
+		for (uint32_t link : curr->links) {
+			if (link == NO_NEIGHBOR || link == slot) {
+				continue;
+			}
+
+			next = &store.get(link);
+
+			if (next->value != VACANT && abs(next->x - curr->x) + abs(next->y - curr->y) +
+				abs(next->z - curr->z) <= dist) {
+				from = root(slot);
+				to = root(link);
+
+				if (from < to) {
+					parent[to] = from;
+				}
+				else if (to < from) {
+					parent[from] = to;
+				}
+			}
+		}
+	}
+
+	for (uint32_t slot = 0; slot < store.size(); slot++) {
+		if (store.get(slot).value == VACANT) {
+			continue;
+		}
+
+		from = root(slot);
+
+		if (cluster[from] == NO_NEIGHBOR) {
+			cluster[from] = uint32_t(found.size());
+			found.push_back(vector<uint32_t>());
+		}
+		found[cluster[from]].push_back(slot);
+	}
+
+	//exclude clusters of self only
+	found.erase(remove_if(found.begin(), found.end(),
+		[](const vector<uint32_t>& members) { return members.size() < 2; }), found.end());
+
+	return found;
+}
+
+void GraphSnapshot::print_clusters(const int dist) const {
+	auto start = chrono::high_resolution_clock::now();
+	vector<vector<uint32_t>> found = clusters(dist);
+	double elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	int counter = 1;
+
+	for (const vector<uint32_t>& cluster : found) {
+		cout << "Cluster " << counter++ << endl;
+
+		for (uint32_t slot : cluster) {
+			cout << store.get(slot).coordinate << " " << store.get(slot).value << " ";
+		}
+		cout << endl;
+	}
+
+	cout << found.size() << " clusters in the snapshot found in " << elapsed << " ms\n" << endl;
+}
@@ -0,0 +1,32 @@
+#ifndef GRAPHSNAPSHOT_H
+#define GRAPHSNAPSHOT_H
+
+#include "VersionedStore.h"
+#include <unordered_map>
+#include <memory>
+
+//the graph as it stood when the snapshot was taken, sharing everything
+//that has not changed since with the live graph. A snapshot can be given
+//hypothetical readings and removals of its own without the live graph
+//seeing them, and can be read on any thread while the live graph goes on
+//taking readings. Copying a snapshot forks it again at no cost
+class GraphSnapshot {
+
+public:
+	GraphSnapshot();
+	GraphSnapshot(const VersionedStore&);
+	size_t size() const;
+	int explicit_size() const;
+	bool set_reading(const string&);
+	bool remove(const string&);
+	vector<vector<uint32_t>> clusters(const int) const;
+	void print_clusters(const int) const;
+	const VersionedReading& reading(uint32_t) const;
+
+private:
+	VersionedStore store;
+	shared_ptr<const unordered_map<string, uint32_t>> lookup;
+	bool find(const string&, uint32_t&);
+};
+
+#endif // !GRAPHSNAPSHOT_H
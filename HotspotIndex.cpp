@@ -0,0 +1,105 @@
+//HotspotIndex.cpp
+#include "stdafx.h"
+#include "HotspotIndex.h"
+#include "Utility.h"
+
+//Ranked index of the readings behind the top k query. It is built the
+//first time it is asked for, so loading pays nothing for it until then, and
+//from that point the graph reports every change of value through update so
+//a query only walks the front of the tree. A query restricted to a region
+//walks from the front skipping readings outside of it, which is cheap when
+//the region holds a fair share of the hot readings. It gives up after
+//HOTSPOT_SCAN_LIMIT readings so the graph can go to the region instead
+
+//ranks every non vacant reading in the columns. The primary reading is
+//ranked rather than the channel mix the columns may hold
+void HotspotIndex::build(const NodeColumns& columns) {
+	vector<Hotspot> readings;
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.nodes[i]->val != VACANT) {
+			readings.push_back(Hotspot{ columns.nodes[i]->val, columns.keys[i],
+				columns.nodes[i]->location_info });
+		}
+	}
+
+	//already in order, so every insert lands at the hint
+	sort(readings.begin(), readings.end(), hotter);
+	ranked.clear();
+
+	for (const Hotspot& reading : readings) {
+		ranked.insert(ranked.end(), reading);
+	}
+	built = true;
+}
+
+//moves a reading from its old value to its new one, either of which may
+//be VACANT for a reading arriving or being removed
+void HotspotIndex::update(const Location* location, uint64_t key, int old_val, int new_val) {
+	if (old_val == new_val) {
+		return;
+	}
+	if (old_val != VACANT) {
+		ranked.erase(Hotspot{ old_val, key, location });
+	}
+	if (new_val != VACANT) {
+		ranked.insert(Hotspot{ new_val, key, location });
+	}
+}
+
+//the k hottest readings, hottest first
+vector<Hotspot> HotspotIndex::top(size_t k) const {
+	vector<Hotspot> found;
+
+	found.reserve(min(k, ranked.size()));
+
+	for (auto it = ranked.begin(); it != ranked.end() && found.size() < k; ++it) {
+		found.push_back(*it);
+	}
+	return found;
+}
+
+//the k hottest readings inside of the box between the two corners, hottest
+//first. Returns false, leaving found incomplete, if HOTSPOT_SCAN_LIMIT
+//readings outside of the box were passed over before k were found
+bool HotspotIndex::top_within(size_t k, const Position& low, const Position& high,
+	vector<Hotspot>& found) const {
+
+	Position lower, upper;
+	size_t skipped = 0;
+
+	lower.x = min(low.x, high.x); upper.x = max(low.x, high.x);
+	lower.y = min(low.y, high.y); upper.y = max(low.y, high.y);
+	lower.z = min(low.z, high.z); upper.z = max(low.z, high.z);
+	found.clear();
+
+	for (auto it = ranked.begin(); it != ranked.end() && found.size() < k; ++it) {
+		if (Utility::in_box(Utility::morton_decode(it->key), lower, upper)) {
+			found.push_back(*it);
+		}
+		else if (++skipped >= HOTSPOT_SCAN_LIMIT) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t HotspotIndex::size() const { return ranked.size(); }
+
+bool HotspotIndex::is_built() const { return built; }
+
+void HotspotIndex::clear() {
+	ranked.clear();
+	built = false;
+}
+
+//the ranking order, hottest first
+bool HotspotIndex::hotter(const Hotspot& a, const Hotspot& b) {
+	if (a.value != b.value) {
+		return a.value > b.value;
+	}
+	if (a.key != b.key) {
+		return a.key < b.key;
+	}
+	return a.location->coordinate < b.location->coordinate;
+}
@@ -0,0 +1,44 @@
+#ifndef HOTSPOTINDEX_H
+#define HOTSPOTINDEX_H
+
+#include <set>
+#include "NodeColumns.h"
+
+#define HOTSPOT_SCAN_LIMIT 4096
+
+struct Location;
+
+//one reading as ranked by the index. key is the z-order key of where it
+//resolved to and location is shared with the node holding it, which stays
+//put when defragment moves the node itself
+struct Hotspot {
+	int value;
+	uint64_t key;
+	const Location* location;
+};
+
+//every non vacant reading kept in order from hottest to coolest, ties
+//broken by z-order and then coordinate so the order never depends on
+//when a reading arrived. A change costs one erase and one insert into the
+//balanced tree and the hottest k are the first k entries
+class HotspotIndex {
+
+public:
+	void build(const NodeColumns&);
+	void update(const Location*, uint64_t, int, int);
+	vector<Hotspot> top(size_t) const;
+	bool top_within(size_t, const Position&, const Position&, vector<Hotspot>&) const;
+	size_t size() const;
+	bool is_built() const;
+	void clear();
+	static bool hotter(const Hotspot&, const Hotspot&);
+
+private:
+	struct Hotter {
+		bool operator()(const Hotspot& a, const Hotspot& b) const { return hotter(a, b); }
+	};
+	set<Hotspot, Hotter> ranked;
+	bool built = false;
+};
+
+#endif // !HOTSPOTINDEX_H
@@ -0,0 +1,440 @@
+//IngestPipeline.cpp
+#include "stdafx.h"
+#include "IngestPipeline.h"
+#include "Utility.h"
+#include <chrono>
+#include <boost/version.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#if BOOST_VERSION >= 106700
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+//Batches are handed between stages by pointer. Parsers finish blocks out
+//of order, so the canonicalizer holds early batches back until the ones
+//ahead of them have been passed on. The reader never hands out a block
+//more than the queue depth past the last batch passed on, which caps how
+//far ahead the parsers can get and how many batches are held back. Parsed
+//blocks go back to the reader to be filled again so their buffers are
+//only allocated once
+
+#define READ 0
+#define PARSE 1
+#define CANONICALIZE 2
+#define INSERT 3
+
+typedef chrono::high_resolution_clock ingest_clock;
+
+static double since(const ingest_clock::time_point& start) {
+	return chrono::duration<double, milli>(ingest_clock::now() - start).count();
+}
+
+//pushes an item, charging any wait on a full queue to the stage
+template <typename T>
+static void push_timed(BoundedQueue<T>& queue, const T& item, StageCounters& counters) {
+	if (!queue.try_push(item)) {
+		auto start = ingest_clock::now();
+		queue.push(item);
+		counters.blocked_ms += since(start);
+	}
+}
+
+//pops an item, charging any wait on an empty queue to the stage
+template <typename T>
+static bool pop_timed(BoundedQueue<T>& queue, T& item, StageCounters& counters) {
+	bool popped;
+
+	if (queue.try_pop(item)) {
+		return true;
+	}
+
+	auto start = ingest_clock::now();
+	popped = queue.pop(item);
+	counters.starved_ms += since(start);
+	return popped;
+}
+
+IngestPipeline::IngestPipeline(RadiationGraph* graph, size_t parsers) :
+	graph(graph), parsers(max(parsers, (size_t)1)), bad_lines(0), released(0), cancelled(false) {}
+
+//opens the file behind whatever decompressor its first bytes call for.
+//Returns the compression found, or -1 with the reason printed if the file
+//cannot be read
+int IngestPipeline::open_source(const string& path, ifstream& file,
+	boost::iostreams::filtering_istream& in) {
+
+	unsigned char magic[4] = { 0, 0, 0, 0 };
+	int compression = INGEST_PLAIN;
+
+	file.open(path, ios::in | ios::binary);
+
+	if (!file.is_open()) {
+		cerr << "Error: Could not open " << path << endl;
+		return -1;
+	}
+
+	file.read((char*)magic, sizeof(magic));
+	file.clear();
+	file.seekg(0);
+
+	if (magic[0] == 0x1f && magic[1] == 0x8b) {
+		compression = INGEST_GZIP;
+		in.push(boost::iostreams::gzip_decompressor(boost::iostreams::gzip::default_window_bits,
+			INGEST_BLOCK));
+	}
+	else if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+		compression = INGEST_ZSTD;
+#if BOOST_VERSION >= 106700
+		in.push(boost::iostreams::zstd_decompressor(INGEST_BLOCK));
+#else
+		cerr << "Error: " << path << " is zstd compressed, which needs Boost 1.67 or later" << endl;
+		return -1;
+#endif
+	}
+
+	in.push(file, INGEST_BLOCK);
+	return compression;
+}
+
+//writes the decompressed contents of a file out to another
+bool IngestPipeline::decompress(const string& from, const string& to) {
+	ifstream file;
+	boost::iostreams::filtering_istream in;
+	ofstream out;
+
+	if (open_source(from, file, in) < 0) {
+		return false;
+	}
+
+	out.open(to, ios::out | ios::binary | ios::trunc);
+
+	try {
+		out << in.rdbuf();
+	}
+	catch (exception& failure) {
+		cerr << "Error: Could not decompress " << from << ": " << failure.what() << endl;
+		return false;
+	}
+
+	return out.good();
+}
+
+//loads every line of the file. Returns false, with the reason printed,
+//if it could not be read
+bool IngestPipeline::load(const string& path) {
+	ifstream file;
+	boost::iostreams::filtering_istream in;
+	BoundedQueue<IngestBlock*> blocks(INGEST_QUEUE_DEPTH), spare(2 * INGEST_QUEUE_DEPTH);
+	BoundedQueue<IngestBatch*> parsed(INGEST_QUEUE_DEPTH), ordered(INGEST_QUEUE_DEPTH);
+	vector<StageCounters> parser_counters(parsers);
+	vector<thread> workers;
+	atomic<size_t> running_parsers(parsers);
+
+	IngestBlock* block;
+
+	if ((compression = open_source(path, file, in)) < 0) {
+		return false;
+	}
+
+	file.seekg(0, ios::end);
+	file_bytes = file.tellg();
+	file.seekg(0);
+
+	bad_lines = 0;
+	released = 0;
+	cancelled = false;
+	error.clear();
+	first_bad.clear();
+
+	auto start = ingest_clock::now();
+
+	//the reader is also the decompression thread
+	workers.push_back(thread([&]() {
+		try {
+			read(in, blocks, spare);
+		}
+		catch (exception& failure) {
+			fail(failure.what());
+		}
+		blocks.close();
+	}));
+
+	for (size_t i = 0; i < parsers; i++) {
+		workers.push_back(thread([&, i]() {
+			try {
+				parse(blocks, spare, parsed, parser_counters[i]);
+			}
+			catch (exception& failure) {
+				fail(failure.what());
+			}
+
+			//the last parser out closes the queue behind it
+			if (--running_parsers == 0) {
+				parsed.close();
+			}
+		}));
+	}
+
+	workers.push_back(thread([&]() {
+		try {
+			canonicalize(parsed, ordered);
+		}
+		catch (exception& failure) {
+			fail(failure.what());
+		}
+		ordered.close();
+	}));
+
+	//never throws, so the workers are always joined
+	insert(ordered);
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	elapsed_ms = since(start);
+
+	while (spare.try_pop(block)) {
+		delete block;
+	}
+
+	for (StageCounters& stage : parser_counters) {
+		counters[PARSE].items += stage.items;
+		counters[PARSE].bytes += stage.bytes;
+		counters[PARSE].busy_ms += stage.busy_ms;
+		counters[PARSE].starved_ms += stage.starved_ms;
+		counters[PARSE].blocked_ms += stage.blocked_ms;
+	}
+
+	if (bad_lines > 0) {
+		cerr << "Skipped " << bad_lines << " lines of " << path << " that could not be parsed, the first: " <<
+			first_bad << endl;
+	}
+
+	if (!error.empty()) {
+		cerr << "Error: Could not load all of " << path << ": " << error << endl;
+		return false;
+	}
+	return true;
+}
+
+//keeps the first failure and stops the reader, the stages after it drain
+//whatever is already on its way
+void IngestPipeline::fail(const string& reason) {
+	lock_guard<mutex> guard(error_lock);
+
+	if (error.empty()) {
+		error = reason;
+	}
+	cancelled = true;
+}
+
+//large reads cut back to the last line break, the partial line is carried
+//over to the front of the next block
+void IngestPipeline::read(istream& in, BoundedQueue<IngestBlock*>& blocks,
+	BoundedQueue<IngestBlock*>& spare) {
+	StageCounters& stage = counters[READ];
+	string carry;
+	IngestBlock* block;
+	size_t sequence = 0, cut;
+
+	auto start = ingest_clock::now();
+
+	while (in && !cancelled) {
+		//wait for the canonicalizer to pass on the batch the queue depth back
+		if (sequence >= released + INGEST_QUEUE_DEPTH) {
+			auto waited = ingest_clock::now();
+
+			while (sequence >= released + INGEST_QUEUE_DEPTH && !cancelled) {
+				this_thread::yield();
+			}
+			stage.blocked_ms += since(waited);
+			continue;
+		}
+
+		if (!spare.try_pop(block)) {
+			block = new IngestBlock;
+		}
+		block->sequence = sequence++;
+		block->text.clear();
+		block->text.append(carry);
+		cut = block->text.size();
+		block->text.resize(cut + INGEST_BLOCK);
+		in.read(&block->text[cut], INGEST_BLOCK);
+		block->text.resize(cut + in.gcount());
+
+		if (in && (cut = block->text.rfind('\n')) != string::npos) {
+			carry.assign(block->text, cut + 1, string::npos);
+			block->text.resize(cut + 1);
+		}
+
+		stage.items++;
+		stage.bytes += block->text.size();
+		push_timed(blocks, block, stage);
+	}
+
+	//the decompressors report bad data by failing the stream
+	if (in.bad()) {
+		fail("the data is corrupt or cut short");
+	}
+
+	stage.busy_ms = since(start) - stage.blocked_ms;
+}
+
+//turns each line of a block into a node, the same way add does. A line
+//that does not parse is counted and left out
+void IngestPipeline::parse(BoundedQueue<IngestBlock*>& blocks, BoundedQueue<IngestBlock*>& spare,
+	BoundedQueue<IngestBatch*>& parsed, StageCounters& stage) {
+
+	IngestBlock* block;
+	IngestBatch* batch;
+	ParsedReading reading;
+	string line;
+	size_t begin, end;
+
+	auto start = ingest_clock::now();
+
+	while (pop_timed(blocks, block, stage)) {
+		batch = new IngestBatch;
+		batch->sequence = block->sequence;
+
+		for (begin = 0; begin < block->text.size(); begin = end + 1) {
+			if ((end = block->text.find('\n', begin)) == string::npos) {
+				end = block->text.size();
+			}
+
+			line = block->text.substr(begin, end - begin);
+
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.empty()) {
+				continue;
+			}
+
+			reading.node = new Node;
+			reading.node->location_info = new Location;
+
+			try {
+				graph->parseCommand(&line, reading.node);
+			}
+			catch (exception&) {
+				delete reading.node->location_info;
+				delete reading.node;
+
+				if (bad_lines++ == 0) {
+					lock_guard<mutex> guard(error_lock);
+					first_bad = line;
+				}
+				continue;
+			}
+			batch->readings.push_back(reading);
+		}
+
+		stage.items += batch->readings.size();
+		stage.bytes += block->text.size();
+		if (!spare.try_push(block)) {
+			delete block;
+		}
+		push_timed(parsed, batch, stage);
+	}
+
+	stage.busy_ms = since(start) - stage.starved_ms - stage.blocked_ms;
+}
+
+//works out the spellings of every coordinate and releases the batches
+//in file order
+void IngestPipeline::canonicalize(BoundedQueue<IngestBatch*>& parsed, BoundedQueue<IngestBatch*>& ordered) {
+	StageCounters& stage = counters[CANONICALIZE];
+	map<size_t, IngestBatch*> waiting;
+	IngestBatch* batch;
+	size_t next = 0;
+
+	auto start = ingest_clock::now();
+
+	while (pop_timed(parsed, batch, stage)) {
+		for (ParsedReading& reading : batch->readings) {
+			reading.keys = Utility::permutations(reading.node->location_info->coordinate);
+		}
+
+		stage.items += batch->readings.size();
+		waiting[batch->sequence] = batch;
+
+		while (!waiting.empty() && waiting.begin()->first == next) {
+			push_timed(ordered, waiting.begin()->second, stage);
+			waiting.erase(waiting.begin());
+			released = ++next;
+		}
+	}
+
+	//only left over when a stage before this one failed
+	for (auto& held : waiting) {
+		for (ParsedReading& reading : held.second->readings) {
+			delete reading.node->location_info;
+			delete reading.node;
+		}
+		delete held.second;
+	}
+
+	stage.busy_ms = since(start) - stage.starved_ms - stage.blocked_ms;
+}
+
+//places the nodes into the graph on the calling thread. Once the load
+//has failed the rest of the nodes are freed instead, so that every stage
+//before this one can run dry
+void IngestPipeline::insert(BoundedQueue<IngestBatch*>& ordered) {
+	StageCounters& stage = counters[INSERT];
+	IngestBatch* batch;
+
+	auto start = ingest_clock::now();
+
+	while (pop_timed(ordered, batch, stage)) {
+		for (ParsedReading& reading : batch->readings) {
+			if (cancelled) {
+				delete reading.node->location_info;
+				delete reading.node;
+				continue;
+			}
+
+			//a node that failed part way may already be linked in, so it
+			//is left to the graph
+			try {
+				graph->insert(reading.node, reading.keys);
+				stage.items++;
+			}
+			catch (exception& failure) {
+				fail(string("could not place ") + reading.node->location_info->coordinate + ": " +
+					failure.what());
+			}
+		}
+
+		delete batch;
+	}
+
+	stage.busy_ms = since(start) - stage.starved_ms;
+}
+
+//prints how much each stage got through and how long it spent waiting on
+//the stage before it (starved) or after it (blocked)
+void IngestPipeline::print_report() {
+	const char* names[INGEST_STAGES] = { "Read", "Parse", "Canonicalize", "Insert" };
+	const char* units[INGEST_STAGES] = { "blocks", "readings", "readings", "readings" };
+
+	const char* formats[] = { "plain", "gzip", "zstd" };
+
+	cout << "Loaded " << counters[INSERT].items << " readings in " << elapsed_ms << " ms (" <<
+		(elapsed_ms > 0 ? counters[INSERT].items / elapsed_ms * 1000 : 0) << " readings/s, " <<
+		parsers << " parsers)" << endl;
+
+	if (compression != INGEST_PLAIN) {
+		cout << "Decompressed " << file_bytes << " bytes of " << formats[compression] << " into " <<
+			counters[READ].bytes << " bytes while loading" << endl;
+	}
+
+	for (int i = 0; i < INGEST_STAGES; i++) {
+		cout << names[i] << ": " << counters[i].items << " " << units[i] << ", " <<
+			counters[i].busy_ms << " ms busy (" <<
+			(counters[i].busy_ms > 0 ? counters[i].items / counters[i].busy_ms * 1000 : 0) <<
+			" " << units[i] << "/s), " << counters[i].starved_ms << " ms starved, " <<
+			counters[i].blocked_ms << " ms blocked" << endl;
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef INGESTPIPELINE_H
+#define INGESTPIPELINE_H
+
+#include "radiationgraph.h"
+#include "BoundedQueue.h"
+#include <fstream>
+#include <mutex>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#define INGEST_BLOCK (1 << 20)
+#define INGEST_QUEUE_DEPTH 8
+#define INGEST_STAGES 4
+#define INGEST_PLAIN 0
+#define INGEST_GZIP 1
+#define INGEST_ZSTD 2
+
+//a run of whole lines read from the file, numbered in file order
+struct IngestBlock {
+	size_t sequence;
+	string text;
+};
+
+//a parsed line along with every spelling of its coordinate
+struct ParsedReading {
+	Node* node;
+	set<string> keys;
+};
+
+//the readings parsed out of one block
+struct IngestBatch {
+	size_t sequence;
+	vector<ParsedReading> readings;
+};
+
+//what one stage got through. Time is summed over the stage's threads
+struct StageCounters {
+	unsigned long long items = 0, bytes = 0;
+	double busy_ms = 0, starved_ms = 0, blocked_ms = 0;
+};
+
+//loads a file into the graph with every step of ingest on its own thread.
+//A reader cuts the file into blocks of whole lines, parser threads turn
+//blocks into nodes, a canonicalizer works out every spelling of each
+//coordinate and puts the batches back in file order, and the calling
+//thread inserts them. The stages are joined by bounded queues so a stage
+//that runs ahead waits on the one behind it and the whole load moves at
+//the speed of the slowest stage. The graph ends up exactly as if each line
+//had been added in turn, apart from blank lines which are skipped.
+//gzip and zstd files are recognised by their first bytes and decompressed
+//by the reader as it goes, so nothing is written out to disk first.
+//Lines that cannot be parsed are skipped and counted. Any other failure
+//stops the reader and every stage drains what it holds before the load
+//returns false
+class IngestPipeline {
+
+public:
+	IngestPipeline(RadiationGraph*, size_t);
+	bool load(const string&);
+	void print_report();
+	static bool decompress(const string&, const string&);
+	static int open_source(const string&, ifstream&, boost::iostreams::filtering_istream&);
+
+private:
+	RadiationGraph* graph;
+	size_t parsers;
+	StageCounters counters[INGEST_STAGES];
+	double elapsed_ms = 0;
+	int compression = INGEST_PLAIN;
+	unsigned long long file_bytes = 0;
+	atomic<unsigned long long> bad_lines;
+	atomic<size_t> released;
+	atomic<bool> cancelled;
+	mutex error_lock;
+	string error, first_bad;
+
+	void read(istream&, BoundedQueue<IngestBlock*>&, BoundedQueue<IngestBlock*>&);
+	void parse(BoundedQueue<IngestBlock*>&, BoundedQueue<IngestBlock*>&, BoundedQueue<IngestBatch*>&,
+		StageCounters&);
+	void canonicalize(BoundedQueue<IngestBatch*>&, BoundedQueue<IngestBatch*>&);
+	void insert(BoundedQueue<IngestBatch*>&);
+	void fail(const string&);
+};
+
+#endif // !INGESTPIPELINE_H
@@ -0,0 +1,537 @@
+//IsoSurface.cpp
+#include "stdafx.h"
+#include "IsoSurface.h"
+#include "Exporter.h"
+#include "Utility.h"
+#include <fstream>
+#include <unordered_map>
+
+//Corners and edges of a cube are numbered as in Bourke's tables. Corner c
+//is bit c of a cube's case, set when the corner is inside. Each case lists
+//the edges its triangles cut, three to a triangle and ending at -1, wound
+//so the normals point out of the inside corners. The table was built by
+//joining the cuts on the six faces into loops around the inside corners,
+//cutting off every inside corner of a face on its own when the face has
+//two diagonally, and triangulating each loop without a chord lying flat in
+//a face, which the cube on the other side could draw too. As a face is
+//always cut the same way whichever of its two cubes is looking, the mesh
+//is closed with every edge shared by exactly two triangles. A
+//vertex is named by the cube edge it lies on, the lower end of the edge
+//relative to the box around the cells along with its axis. An edge running
+//to a cell without a reading is cut halfway
+
+static const int CORNERS[8][3] = {
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+	{ 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 }
+};
+
+static const int EDGES[12][2] = {
+	{ 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 4, 5 }, { 5, 6 },
+	{ 6, 7 }, { 7, 4 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+static const int8_t TRIANGLES[256][16] = {
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 10, 2, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 10, 2, 9, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 9, 2, 9, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 3, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 11, 3, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 8, 1, 8, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 11, 3, 10, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 11, 0, 11, 8, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 10, 11, 9, 11, 3, 9, 3, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 9, 10, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 7, 1, 7, 4, 1, 4, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 4, 10, 2, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 10, 2, 9, 2, 0, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 7, 2, 7, 4, 2, 4, 9, 2, 9, 10, -1, -1, -1, -1 },
+	{ 11, 3, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 7, 0, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 11, 3, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 7, 1, 7, 4, 1, 4, 9, -1, -1, -1, -1 },
+	{ 10, 11, 3, 10, 3, 1, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 11, 0, 11, 7, 0, 7, 4, -1, -1, -1, -1 },
+	{ 9, 10, 11, 9, 11, 3, 9, 3, 0, 8, 7, 4, -1, -1, -1, -1 },
+	{ 9, 10, 11, 9, 11, 7, 9, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 1, 4, 1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 4, 1, 4, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 10, 2, 1, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 10, 4, 10, 2, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 4, 2, 4, 5, 2, 5, 10, -1, -1, -1, -1 },
+	{ 11, 3, 2, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 8, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 1, 4, 1, 0, 11, 3, 2, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 8, 1, 8, 4, 1, 4, 5, -1, -1, -1, -1 },
+	{ 10, 11, 3, 10, 3, 1, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 11, 0, 11, 8, 4, 5, 9, -1, -1, -1, -1 },
+	{ 4, 5, 10, 4, 10, 11, 4, 11, 3, 4, 3, 0, -1, -1, -1, -1 },
+	{ 4, 5, 10, 4, 10, 11, 4, 11, 8, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 8, 7, 9, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 5, 0, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 7, 5, 8, 5, 1, 8, 1, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, 9, 8, 7, 9, 7, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 5, 0, 5, 9, 10, 2, 1, -1, -1, -1, -1 },
+	{ 8, 7, 5, 8, 5, 10, 8, 10, 2, 8, 2, 0, -1, -1, -1, -1 },
+	{ 2, 3, 7, 2, 7, 5, 2, 5, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 3, 2, 9, 8, 7, 9, 7, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 7, 0, 7, 5, 0, 5, 9, -1, -1, -1, -1 },
+	{ 8, 7, 5, 8, 5, 1, 8, 1, 0, 11, 3, 2, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 7, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 11, 3, 10, 3, 1, 9, 8, 7, 9, 7, 5, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 11, 0, 11, 7, 0, 7, 5, 0, 5, 9, -1 },
+	{ 5, 10, 11, 5, 11, 3, 5, 3, 0, 5, 0, 8, 5, 8, 7, -1 },
+	{ 10, 11, 7, 10, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 9, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 5, 6, 2, 5, 2, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 5, 6, 2, 5, 2, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 5, 6, 9, 6, 2, 9, 2, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 9, 2, 9, 5, 2, 5, 6, -1, -1, -1, -1 },
+	{ 11, 3, 2, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 11, 3, 2, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 8, 1, 8, 9, 5, 6, 10, -1, -1, -1, -1 },
+	{ 5, 6, 11, 5, 11, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 5, 0, 5, 6, 0, 6, 11, 0, 11, 8, -1, -1, -1, -1 },
+	{ 9, 5, 6, 9, 6, 11, 9, 11, 3, 9, 3, 0, -1, -1, -1, -1 },
+	{ 5, 6, 11, 5, 11, 8, 5, 8, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 7, 4, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 4, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 8, 7, 4, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 7, 1, 7, 4, 1, 4, 9, 5, 6, 10, -1, -1, -1, -1 },
+	{ 5, 6, 2, 5, 2, 1, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 4, 5, 6, 2, 5, 2, 1, -1, -1, -1, -1 },
+	{ 9, 5, 6, 9, 6, 2, 9, 2, 0, 8, 7, 4, -1, -1, -1, -1 },
+	{ 2, 3, 7, 2, 7, 4, 2, 4, 9, 2, 9, 5, 2, 5, 6, -1 },
+	{ 11, 3, 2, 8, 7, 4, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 7, 0, 7, 4, 5, 6, 10, -1, -1, -1, -1 },
+	{ 9, 1, 0, 11, 3, 2, 8, 7, 4, 5, 6, 10, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 7, 1, 7, 4, 1, 4, 9, 5, 6, 10, -1 },
+	{ 5, 6, 11, 5, 11, 3, 5, 3, 1, 8, 7, 4, -1, -1, -1, -1 },
+	{ 0, 1, 5, 0, 5, 6, 0, 6, 11, 0, 11, 7, 0, 7, 4, -1 },
+	{ 9, 5, 6, 9, 6, 11, 9, 11, 3, 9, 3, 0, 8, 7, 4, -1 },
+	{ 9, 5, 6, 9, 6, 11, 9, 11, 7, 9, 7, 4, -1, -1, -1, -1 },
+	{ 4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 6, 10, 4, 10, 1, 4, 1, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 4, 1, 4, 6, 1, 6, 10, -1, -1, -1, -1 },
+	{ 9, 4, 6, 9, 6, 2, 9, 2, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 9, 4, 6, 9, 6, 2, 9, 2, 1, -1, -1, -1, -1 },
+	{ 4, 6, 2, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 4, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 3, 2, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 8, 4, 6, 10, 4, 10, 9, -1, -1, -1, -1 },
+	{ 4, 6, 10, 4, 10, 1, 4, 1, 0, 11, 3, 2, -1, -1, -1, -1 },
+	{ 1, 2, 11, 1, 11, 8, 1, 8, 4, 1, 4, 6, 1, 6, 10, -1 },
+	{ 9, 4, 6, 9, 6, 11, 9, 11, 3, 9, 3, 1, -1, -1, -1, -1 },
+	{ 1, 9, 4, 1, 4, 6, 1, 6, 11, 1, 11, 8, 1, 8, 0, -1 },
+	{ 4, 6, 11, 4, 11, 3, 4, 3, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 6, 11, 4, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 9, 8, 10, 8, 7, 10, 7, 6, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 7, 0, 7, 6, 0, 6, 10, 0, 10, 9, -1, -1, -1, -1 },
+	{ 8, 7, 6, 8, 6, 10, 8, 10, 1, 8, 1, 0, -1, -1, -1, -1 },
+	{ 1, 3, 7, 1, 7, 6, 1, 6, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 8, 7, 9, 7, 6, 9, 6, 2, 9, 2, 1, -1, -1, -1, -1 },
+	{ 7, 6, 2, 7, 2, 1, 7, 1, 9, 7, 9, 0, 7, 0, 3, -1 },
+	{ 8, 7, 6, 8, 6, 2, 8, 2, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 7, 2, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 3, 2, 10, 9, 8, 10, 8, 7, 10, 7, 6, -1, -1, -1, -1 },
+	{ 0, 2, 11, 0, 11, 7, 0, 7, 6, 0, 6, 10, 0, 10, 9, -1 },
+	{ 8, 7, 6, 8, 6, 10, 8, 10, 1, 8, 1, 0, 11, 3, 2, -1 },
+	{ 1, 2, 11, 1, 11, 7, 1, 7, 6, 1, 6, 10, -1, -1, -1, -1 },
+	{ 9, 8, 7, 9, 7, 6, 9, 6, 11, 9, 11, 3, 9, 3, 1, -1 },
+	{ 0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 6, 11, 3, 6, 3, 0, 6, 0, 8, 6, 8, 7, -1, -1, -1, -1 },
+	{ 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 10, 2, 1, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 10, 2, 9, 2, 0, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 9, 2, 9, 10, 6, 7, 11, -1, -1, -1, -1 },
+	{ 6, 7, 3, 6, 3, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 6, 0, 6, 7, 0, 7, 8, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 6, 7, 3, 6, 3, 2, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 2, 6, 1, 6, 7, 1, 7, 8, 1, 8, 9, -1, -1, -1, -1 },
+	{ 10, 6, 7, 10, 7, 3, 10, 3, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 6, 0, 6, 7, 0, 7, 8, -1, -1, -1, -1 },
+	{ 9, 10, 6, 9, 6, 7, 9, 7, 3, 9, 3, 0, -1, -1, -1, -1 },
+	{ 6, 7, 8, 6, 8, 9, 6, 9, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 11, 6, 8, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 8, 11, 6, 8, 6, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 11, 1, 11, 6, 1, 6, 4, 1, 4, 9, -1, -1, -1, -1 },
+	{ 10, 2, 1, 8, 11, 6, 8, 6, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 6, 0, 6, 4, 10, 2, 1, -1, -1, -1, -1 },
+	{ 9, 10, 2, 9, 2, 0, 8, 11, 6, 8, 6, 4, -1, -1, -1, -1 },
+	{ 3, 11, 6, 3, 6, 4, 3, 4, 9, 3, 9, 10, 3, 10, 2, -1 },
+	{ 6, 4, 8, 6, 8, 3, 6, 3, 2, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 6, 4, 8, 6, 8, 3, 6, 3, 2, -1, -1, -1, -1 },
+	{ 1, 2, 6, 1, 6, 4, 1, 4, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 6, 4, 10, 4, 8, 10, 8, 3, 10, 3, 1, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 6, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 6, 4, 10, 4, 8, 10, 8, 3, 10, 3, 0, 10, 0, 9, -1 },
+	{ 9, 10, 6, 9, 6, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 5, 1, 4, 1, 0, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 4, 1, 4, 5, 6, 7, 11, -1, -1, -1, -1 },
+	{ 10, 2, 1, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 10, 2, 1, 4, 5, 9, 6, 7, 11, -1, -1, -1, -1 },
+	{ 4, 5, 10, 4, 10, 2, 4, 2, 0, 6, 7, 11, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 4, 2, 4, 5, 2, 5, 10, 6, 7, 11, -1 },
+	{ 6, 7, 3, 6, 3, 2, 4, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 6, 0, 6, 7, 0, 7, 8, 4, 5, 9, -1, -1, -1, -1 },
+	{ 4, 5, 1, 4, 1, 0, 6, 7, 3, 6, 3, 2, -1, -1, -1, -1 },
+	{ 1, 2, 6, 1, 6, 7, 1, 7, 8, 1, 8, 4, 1, 4, 5, -1 },
+	{ 10, 6, 7, 10, 7, 3, 10, 3, 1, 4, 5, 9, -1, -1, -1, -1 },
+	{ 0, 1, 10, 0, 10, 6, 0, 6, 7, 0, 7, 8, 4, 5, 9, -1 },
+	{ 10, 6, 7, 10, 7, 3, 10, 3, 0, 10, 0, 4, 10, 4, 5, -1 },
+	{ 10, 6, 7, 10, 7, 8, 10, 8, 4, 10, 4, 5, -1, -1, -1, -1 },
+	{ 9, 8, 11, 9, 11, 6, 9, 6, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1 },
+	{ 8, 11, 6, 8, 6, 5, 8, 5, 1, 8, 1, 0, -1, -1, -1, -1 },
+	{ 1, 3, 11, 1, 11, 6, 1, 6, 5, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 2, 1, 9, 8, 11, 9, 11, 6, 9, 6, 5, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 6, 0, 6, 5, 0, 5, 9, 10, 2, 1, -1 },
+	{ 8, 11, 6, 8, 6, 5, 8, 5, 10, 8, 10, 2, 8, 2, 0, -1 },
+	{ 3, 11, 6, 3, 6, 5, 3, 5, 10, 3, 10, 2, -1, -1, -1, -1 },
+	{ 6, 5, 9, 6, 9, 8, 6, 8, 3, 6, 3, 2, -1, -1, -1, -1 },
+	{ 0, 2, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 3, 2, 8, 2, 6, 8, 6, 5, 8, 5, 1, 8, 1, 0, -1 },
+	{ 1, 2, 6, 1, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 6, 5, 9, 6, 9, 8, 6, 8, 3, 6, 3, 1, 6, 1, 10, -1 },
+	{ 0, 1, 10, 0, 10, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1 },
+	{ 8, 3, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 9, 5, 7, 11, 5, 11, 10, -1, -1, -1, -1 },
+	{ 5, 7, 11, 5, 11, 2, 5, 2, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 5, 7, 11, 5, 11, 2, 5, 2, 1, -1, -1, -1, -1 },
+	{ 9, 5, 7, 9, 7, 11, 9, 11, 2, 9, 2, 0, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 9, 2, 9, 5, 2, 5, 7, 2, 7, 11, -1 },
+	{ 10, 5, 7, 10, 7, 3, 10, 3, 2, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 10, 0, 10, 5, 0, 5, 7, 0, 7, 8, -1, -1, -1, -1 },
+	{ 9, 1, 0, 10, 5, 7, 10, 7, 3, 10, 3, 2, -1, -1, -1, -1 },
+	{ 2, 10, 5, 2, 5, 7, 2, 7, 8, 2, 8, 9, 2, 9, 1, -1 },
+	{ 5, 7, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 5, 0, 5, 7, 0, 7, 8, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 5, 7, 9, 7, 3, 9, 3, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 5, 7, 8, 5, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 11, 10, 8, 10, 5, 8, 5, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 10, 0, 10, 5, 0, 5, 4, -1, -1, -1, -1 },
+	{ 9, 1, 0, 8, 11, 10, 8, 10, 5, 8, 5, 4, -1, -1, -1, -1 },
+	{ 3, 11, 10, 3, 10, 5, 3, 5, 4, 3, 4, 9, 3, 9, 1, -1 },
+	{ 5, 4, 8, 5, 8, 11, 5, 11, 2, 5, 2, 1, -1, -1, -1, -1 },
+	{ 11, 2, 1, 11, 1, 5, 11, 5, 4, 11, 4, 0, 11, 0, 3, -1 },
+	{ 5, 4, 8, 5, 8, 11, 5, 11, 2, 5, 2, 0, 5, 0, 9, -1 },
+	{ 2, 3, 11, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 5, 4, 10, 4, 8, 10, 8, 3, 10, 3, 2, -1, -1, -1, -1 },
+	{ 0, 2, 10, 0, 10, 5, 0, 5, 4, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 1, 0, 10, 5, 4, 10, 4, 8, 10, 8, 3, 10, 3, 2, -1 },
+	{ 2, 10, 5, 2, 5, 4, 2, 4, 9, 2, 9, 1, -1, -1, -1, -1 },
+	{ 5, 4, 8, 5, 8, 3, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 5, 0, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 5, 4, 8, 5, 8, 3, 5, 3, 0, 5, 0, 9, -1, -1, -1, -1 },
+	{ 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 7, 11, 4, 11, 10, 4, 10, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 4, 7, 11, 4, 11, 10, 4, 10, 9, -1, -1, -1, -1 },
+	{ 4, 7, 11, 4, 11, 10, 4, 10, 1, 4, 1, 0, -1, -1, -1, -1 },
+	{ 1, 3, 8, 1, 8, 4, 1, 4, 7, 1, 7, 11, 1, 11, 10, -1 },
+	{ 9, 4, 7, 9, 7, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1 },
+	{ 0, 3, 8, 9, 4, 7, 9, 7, 11, 9, 11, 2, 9, 2, 1, -1 },
+	{ 4, 7, 11, 4, 11, 2, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 8, 2, 8, 4, 2, 4, 7, 2, 7, 11, -1, -1, -1, -1 },
+	{ 10, 9, 4, 10, 4, 7, 10, 7, 3, 10, 3, 2, -1, -1, -1, -1 },
+	{ 2, 10, 9, 2, 9, 4, 2, 4, 7, 2, 7, 8, 2, 8, 0, -1 },
+	{ 4, 7, 3, 4, 3, 2, 4, 2, 10, 4, 10, 1, 4, 1, 0, -1 },
+	{ 1, 2, 10, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 4, 7, 9, 7, 3, 9, 3, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 9, 4, 1, 4, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1 },
+	{ 4, 7, 3, 4, 3, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 10, 9, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 3, 11, 0, 11, 10, 0, 10, 9, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 11, 10, 8, 10, 1, 8, 1, 0, -1, -1, -1, -1, -1, -1, -1 },
+	{ 1, 3, 11, 1, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 8, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 11, 2, 1, 11, 1, 9, 11, 9, 0, 11, 0, 3, -1, -1, -1, -1 },
+	{ 8, 11, 2, 8, 2, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 10, 9, 8, 10, 8, 3, 10, 3, 2, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 2, 10, 0, 10, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 3, 2, 8, 2, 10, 8, 10, 1, 8, 1, 0, -1, -1, -1, -1 },
+	{ 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 9, 8, 3, 9, 3, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ 8, 3, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }
+};
+
+//cuts every cube with a corner inside
+void IsoSurface::extract(const NodeColumns& columns, const DoseGrid& grid, const double threshold) {
+	unordered_map<uint64_t, uint32_t> shared;
+	pair<unordered_map<uint64_t, uint32_t>::iterator, bool> placed;
+	Position low, high;
+	uint64_t span[3];
+
+	clear();
+	grid.bounds(low, high);
+
+	//cubes reach one cell past the box on the low side
+	span[0] = uint64_t(high.x - low.x) + 2;
+	span[1] = uint64_t(high.y - low.y) + 2;
+	span[2] = uint64_t(high.z - low.z) + 2;
+
+	pieces.resize(Utility::thread_count());
+
+	Utility::parallel_for(columns.size(), [&](size_t chunk, size_t begin, size_t end) {
+		Piece& piece = pieces[chunk];
+		unordered_map<uint64_t, uint32_t> local;
+		pair<unordered_map<uint64_t, uint32_t>::iterator, bool> found;
+		int around[27], cell[3], at[3], lower[3], near_at[2], val, cube, axis, ends[2];
+		uint64_t key;
+		float fraction;
+		bool buried;
+
+		auto inside = [threshold](int val) { return val != VACANT && val >= threshold; };
+
+		for (size_t i = begin; i < end; i++) {
+			//each cell once, however many nodes share it
+			if (i > 0 && columns.keys[i] == columns.keys[i - 1]) {
+				continue;
+			}
+
+			cell[0] = columns.x[i];
+			cell[1] = columns.y[i];
+			cell[2] = columns.z[i];
+
+			if (!inside(grid.value_at(cell))) {
+				continue;
+			}
+
+			buried = true;
+
+			//the cells around this one, from -1 to 1 along each axis
+			for (int dz = 0; dz < 3; dz++) {
+				for (int dy = 0; dy < 3; dy++) {
+					for (int dx = 0; dx < 3; dx++) {
+						at[0] = cell[0] + dx - 1;
+						at[1] = cell[1] + dy - 1;
+						at[2] = cell[2] + dz - 1;
+						around[(dz * 3 + dy) * 3 + dx] = grid.value_at(at);
+						buried = buried && inside(around[(dz * 3 + dy) * 3 + dx]);
+					}
+				}
+			}
+
+			//no cube around a cell deep inside is cut
+			if (buried) {
+				continue;
+			}
+
+			//this cell is corner k of the cube whose lowest corner sits
+			//CORNERS[k] below it
+			for (int k = 0; k < 8; k++) {
+				cube = 0;
+
+				for (int c = 0; c < 8; c++) {
+					if (inside(around[((CORNERS[c][2] - CORNERS[k][2] + 1) * 3 + CORNERS[c][1] -
+						CORNERS[k][1] + 1) * 3 + CORNERS[c][0] - CORNERS[k][0] + 1])) {
+						cube |= 1 << c;
+					}
+				}
+
+				//an earlier corner is inside and takes the cube
+				if (cube & ((1 << k) - 1)) {
+					continue;
+				}
+
+				for (int t = 0; TRIANGLES[cube][t] != -1; t++) {
+					ends[0] = EDGES[TRIANGLES[cube][t]][0];
+					ends[1] = EDGES[TRIANGLES[cube][t]][1];
+					axis = 0;
+
+					for (int dim = 0; dim < 3; dim++) {
+						if (CORNERS[ends[0]][dim] != CORNERS[ends[1]][dim]) {
+							axis = dim;
+						}
+						lower[dim] = cell[dim] - CORNERS[k][dim] + min(CORNERS[ends[0]][dim], CORNERS[ends[1]][dim]);
+					}
+
+					key = ((uint64_t(lower[2] - low.z + 1) * span[1] + uint64_t(lower[1] - low.y + 1)) *
+						span[0] + uint64_t(lower[0] - low.x + 1)) * 3 + axis;
+					found = local.emplace(key, (uint32_t)piece.keys.size());
+
+					if (found.second) {
+						for (int e = 0; e < 2; e++) {
+							near_at[e] = ((CORNERS[ends[e]][2] - CORNERS[k][2] + 1) * 3 + CORNERS[ends[e]][1] -
+								CORNERS[k][1] + 1) * 3 + CORNERS[ends[e]][0] - CORNERS[k][0] + 1;
+						}
+
+						//how far along the edge from its first corner to its second
+						val = around[near_at[0]];
+						fraction = val == VACANT || around[near_at[1]] == VACANT ? 0.5f :
+							float((threshold - val) / (around[near_at[1]] - val));
+
+						piece.keys.push_back(key);
+
+						for (int dim = 0; dim < 3; dim++) {
+							piece.points.push_back(float(cell[dim] - CORNERS[k][dim] + CORNERS[ends[0]][dim]) +
+								fraction * float(CORNERS[ends[1]][dim] - CORNERS[ends[0]][dim]));
+						}
+					}
+					piece.triangles.push_back(found.first->second);
+				}
+			}
+		}
+	});
+
+	//weld in worker order, so the mesh comes out the same however the
+	//work was scheduled
+	for (Piece& piece : pieces) {
+		piece.first = (uint32_t)vertices;
+		piece.welded.resize(piece.keys.size());
+
+		for (size_t v = 0; v < piece.keys.size(); v++) {
+			placed = shared.emplace(piece.keys[v], (uint32_t)vertices);
+			vertices += placed.second;
+			piece.welded[v] = placed.first->second;
+		}
+		triangles += piece.triangles.size() / 3;
+	}
+}
+
+//writes the mesh as binary PLY or as OBJ. Returns false if the file could
+//not be written
+bool IsoSurface::write(const string& path, const int format) const {
+	vector<char> buffer(EXPORT_BUFFER);
+	ofstream out;
+
+	out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	out.open(path, ios::out | ios::binary | ios::trunc);
+
+	if (!out.is_open()) {
+		return false;
+	}
+
+	if (format == MESH_OBJ) {
+		write_obj(out);
+	}
+	else {
+		write_ply(out);
+	}
+
+	out.close();
+	return !out.fail();
+}
+
+//little endian floats for the vertices and a count of 3 then 3 unsigned
+//ints for each face
+void IsoSurface::write_ply(ostream& out) const {
+	string bytes = "ply\nformat binary_little_endian 1.0\nelement vertex " + to_string(vertices) +
+		"\nproperty float x\nproperty float y\nproperty float z\nelement face " + to_string(triangles) +
+		"\nproperty list uchar uint vertex_indices\nend_header\n";
+	uint32_t raw;
+
+	for (const Piece& piece : pieces) {
+		for (size_t v = 0; v < piece.welded.size(); v++) {
+			if (piece.welded[v] < piece.first) {
+				continue;
+			}
+
+			for (int dim = 0; dim < 3; dim++) {
+				memcpy(&raw, &piece.points[v * 3 + dim], sizeof(raw));
+				Exporter::append_raw(bytes, raw);
+			}
+			flush(bytes, out, false);
+		}
+	}
+
+	for (const Piece& piece : pieces) {
+		for (size_t t = 0; t < piece.triangles.size(); t += 3) {
+			bytes.push_back(3);
+
+			for (int corner = 0; corner < 3; corner++) {
+				Exporter::append_raw(bytes, piece.welded[piece.triangles[t + corner]]);
+			}
+			flush(bytes, out, false);
+		}
+	}
+	flush(bytes, out, true);
+}
+
+void IsoSurface::write_obj(ostream& out) const {
+	string text = "# " + to_string(vertices) + " vertices, " + to_string(triangles) + " triangles\n";
+	char number[32];
+
+	for (const Piece& piece : pieces) {
+		for (size_t v = 0; v < piece.welded.size(); v++) {
+			if (piece.welded[v] < piece.first) {
+				continue;
+			}
+
+			text.push_back('v');
+
+			for (int dim = 0; dim < 3; dim++) {
+				text.append(number, snprintf(number, sizeof(number), " %g", piece.points[v * 3 + dim]));
+			}
+			text.push_back('\n');
+			flush(text, out, false);
+		}
+	}
+
+	//OBJ counts vertices from 1
+	for (const Piece& piece : pieces) {
+		for (size_t t = 0; t < piece.triangles.size(); t += 3) {
+			text.push_back('f');
+
+			for (int corner = 0; corner < 3; corner++) {
+				text.push_back(' ');
+				Exporter::append_int(text, (long long)piece.welded[piece.triangles[t + corner]] + 1);
+			}
+			text.push_back('\n');
+			flush(text, out, false);
+		}
+	}
+	flush(text, out, true);
+}
+
+//hands the text over to the stream once there is a buffer's worth of it,
+//or whatever is left at the end
+void IsoSurface::flush(string& text, ostream& out, const bool last) {
+	if (last || text.size() >= EXPORT_BUFFER) {
+		out.write(text.data(), text.size());
+		text.clear();
+	}
+}
+
+size_t IsoSurface::vertex_count() const { return vertices; }
+
+size_t IsoSurface::triangle_count() const { return triangles; }
+
+void IsoSurface::clear() {
+	pieces.clear();
+	vertices = triangles = 0;
+}
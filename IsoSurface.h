@@ -0,0 +1,48 @@
+#ifndef ISOSURFACE_H
+#define ISOSURFACE_H
+
+#include "NodeColumns.h"
+#include "DoseGrid.h"
+#include <string>
+
+#define MESH_PLY 1
+#define MESH_OBJ 2
+
+//triangle mesh of the surface where the readings cross a threshold, found
+//with marching cubes over the cells of a DoseGrid. The corners of each cube
+//are cell centers and a corner is inside when its cell has a reading of at
+//least the threshold. Only cubes with a corner inside can be cut, so rather
+//than every cube of the box each inside cell looks at the 8 cubes it is a
+//corner of and takes those it is the first inside corner of. The inside
+//cells are split between the workers in z-order, each keeping its own
+//vertices and triangles. The workers' vertices are welded together
+//afterwards and the mesh is written straight from their buffers
+class IsoSurface {
+
+public:
+	void extract(const NodeColumns&, const DoseGrid&, const double);
+	bool write(const string&, const int) const;
+	size_t vertex_count() const;
+	size_t triangle_count() const;
+	void clear();
+
+private:
+	//what one worker found. keys names the cube edge each vertex lies on,
+	//welded is its index in the whole mesh and first the lowest index this
+	//worker handed out, so a vertex with a lower one was written by an
+	//earlier worker
+	struct Piece {
+		vector<uint64_t> keys;
+		vector<float> points;
+		vector<uint32_t> triangles, welded;
+		uint32_t first = 0;
+	};
+
+	vector<Piece> pieces;
+	size_t vertices = 0, triangles = 0;
+	void write_ply(ostream&) const;
+	void write_obj(ostream&) const;
+	static void flush(string&, ostream&, const bool);
+};
+
+#endif // !ISOSURFACE_H
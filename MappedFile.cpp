@@ -0,0 +1,225 @@
+//MappedFile.cpp
+#include "stdafx.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Windows are mapped from the nearest allocation boundary at or below their
+//first byte, which is the page size on POSIX and 64 KB under Windows, and
+//data points at the first byte itself
+
+//the boundary mappings have to start on
+static uint64_t map_granularity() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+//opens an existing file whose windows start at base and hold window_bytes
+//each
+bool MappedFile::open(const string& file_path, uint64_t base_offset, size_t window_size, bool write) {
+	close();
+
+	path = file_path;
+	base = base_offset;
+	window_bytes = window_size;
+	writable = write;
+
+#ifdef _WIN32
+	LARGE_INTEGER length;
+
+	file = CreateFileA(path.c_str(), GENERIC_READ | (write ? GENERIC_WRITE : 0), FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length)) {
+		file = nullptr;
+		return false;
+	}
+
+	file_size = length.QuadPart;
+	mapping = file_size == 0 ? nullptr :
+		CreateFileMappingA(file, nullptr, write ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+
+	if (file_size != 0 && mapping == nullptr) {
+		close();
+		return false;
+	}
+#else
+	struct stat info;
+
+	file = ::open(path.c_str(), write ? O_RDWR : O_RDONLY);
+
+	if (file < 0 || fstat(file, &info) != 0) {
+		close();
+		return false;
+	}
+
+	file_size = info.st_size;
+#endif
+
+	return true;
+}
+
+//makes a file of the given size, replacing any that was there, and opens
+//it for writing
+bool MappedFile::create(const string& file_path, uint64_t length, uint64_t base_offset,
+	size_t window_size) {
+
+	close();
+
+#ifdef _WIN32
+	HANDLE created = CreateFileA(file_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER end;
+
+	if (created == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	end.QuadPart = length;
+
+	if (!SetFilePointerEx(created, end, nullptr, FILE_BEGIN) || !SetEndOfFile(created)) {
+		CloseHandle(created);
+		return false;
+	}
+	CloseHandle(created);
+#else
+	int created = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (created < 0) {
+		return false;
+	}
+	if (ftruncate(created, (off_t)length) != 0) {
+		::close(created);
+		return false;
+	}
+	::close(created);
+#endif
+
+	return open(file_path, base_offset, window_size, true);
+}
+
+void MappedFile::close() {
+	for (Window& mapped : windows) {
+		unmap(mapped);
+	}
+	windows.clear();
+	last = 0;
+
+#ifdef _WIN32
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != nullptr) {
+		CloseHandle(file);
+		file = nullptr;
+	}
+#else
+	if (file >= 0) {
+		::close(file);
+		file = -1;
+	}
+#endif
+}
+
+//the start of a window, mapping it if it is not already. The last window
+//may be shorter than the rest
+char* MappedFile::window(uint64_t index) {
+	const uint64_t granularity = map_granularity();
+	uint64_t start, aligned, end;
+	size_t victim = 0;
+	Window mapped;
+
+	if (last < windows.size() && windows[last].index == index) {
+		windows[last].last_used = ++clock;
+		return windows[last].data;
+	}
+
+	for (size_t i = 0; i < windows.size(); i++) {
+		if (windows[i].index == index) {
+			windows[i].last_used = ++clock;
+			last = i;
+			return windows[i].data;
+		}
+		if (windows[i].last_used < windows[victim].last_used) {
+			victim = i;
+		}
+	}
+
+	start = base + index * window_bytes;
+	end = min(start + window_bytes, file_size);
+
+	if (start >= end) {
+		return nullptr;
+	}
+
+	aligned = start - start % granularity;
+	mapped.index = index;
+	mapped.length = (size_t)(end - aligned);
+	mapped.last_used = ++clock;
+
+#ifdef _WIN32
+	mapped.mapping = (char*)MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+		(DWORD)(aligned >> 32), (DWORD)(aligned & 0xffffffff), mapped.length);
+
+	if (mapped.mapping == nullptr) {
+		return nullptr;
+	}
+#else
+	mapped.mapping = (char*)mmap(nullptr, mapped.length, PROT_READ | (writable ? PROT_WRITE : 0),
+		MAP_SHARED, file, (off_t)aligned);
+
+	if (mapped.mapping == (char*)MAP_FAILED) {
+		return nullptr;
+	}
+#endif
+
+	mapped.data = mapped.mapping + (start - aligned);
+	maps++;
+
+	if (windows.size() < MAPPED_RESIDENT) {
+		windows.push_back(mapped);
+		last = windows.size() - 1;
+	}
+	else {
+		unmap(windows[victim]);
+		windows[victim] = mapped;
+		last = victim;
+	}
+
+	return mapped.data;
+}
+
+void MappedFile::unmap(Window& mapped) {
+#ifdef _WIN32
+	UnmapViewOfFile(mapped.mapping);
+#else
+	munmap(mapped.mapping, mapped.length);
+#endif
+}
+
+uint64_t MappedFile::size() const { return file_size; }
+
+//how many times a window has been mapped in, a measure of how much of the
+//file has been paged through
+unsigned long long MappedFile::get_maps() const { return maps; }
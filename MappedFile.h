@@ -0,0 +1,57 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+#define MAPPED_RESIDENT 16
+
+//a file reached through a handful of mapped windows instead of being mapped
+//whole. The part past the base offset is cut into windows of a fixed size
+//and at most MAPPED_RESIDENT of them are mapped at once, the least recently
+//used one making way for the next, so the memory the file takes up stays
+//bounded however large it grows. A pointer from window() stays good until
+//MAPPED_RESIDENT other windows have been asked for
+class MappedFile {
+
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(const string&, uint64_t, size_t, bool);
+	bool create(const string&, uint64_t, uint64_t, size_t);
+	void close();
+	char* window(uint64_t);
+	uint64_t size() const;
+	unsigned long long get_maps() const;
+
+private:
+	struct Window {
+		uint64_t index;
+		char* mapping;
+		char* data;
+		size_t length;
+		unsigned long long last_used;
+	};
+
+	string path;
+	uint64_t file_size = 0, base = 0;
+	size_t window_bytes = 0;
+	bool writable = false;
+	vector<Window> windows;
+	unsigned long long clock = 0, maps = 0;
+	size_t last = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+	void unmap(Window&);
+};
+
+#endif // !MAPPEDFILE_H
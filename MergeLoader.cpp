@@ -0,0 +1,301 @@
+//MergeLoader.cpp
+#include "stdafx.h"
+#include "MergeLoader.h"
+#include "Utility.h"
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+
+//Each file is parsed, canonicalized and held in full by whichever worker
+//picks it up. The merge then walks the files in name order and each file
+//top to bottom, so a coordinate is inserted where it was first read and
+//the graph grows in the same order a single concatenated file would give
+
+namespace fs = boost::filesystem;
+
+typedef chrono::high_resolution_clock merge_clock;
+
+static double since(const merge_clock::time_point& start) {
+	return chrono::duration<double, milli>(merge_clock::now() - start).count();
+}
+
+//true if the name matches a pattern where * is any run of characters
+//and ? is any one character
+static bool wildcard_match(const string& name, const string& pattern) {
+	size_t n = 0, p = 0, star = string::npos, resume = 0;
+
+	while (n < name.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+			n++;
+			p++;
+		}
+		else if (p < pattern.size() && pattern[p] == '*') {
+			star = p++;
+			resume = n;
+		}
+		else if (star != string::npos) {
+			p = star + 1;
+			n = ++resume;
+		}
+		else {
+			return false;
+		}
+	}
+
+	while (p < pattern.size() && pattern[p] == '*') {
+		p++;
+	}
+	return p == pattern.size();
+}
+
+MergeLoader::MergeLoader(RadiationGraph* graph, int rule) : graph(graph), rule(rule) {}
+
+//the rule named last, max or mean, or -1 if it is none of them
+int MergeLoader::parse_rule(const string& name) {
+	if (name == "last") {
+		return MERGE_LAST;
+	}
+	else if (name == "max") {
+		return MERGE_MAX;
+	}
+	else if (name == "mean") {
+		return MERGE_MEAN;
+	}
+	return -1;
+}
+
+//turns the arguments into the sorted list of files to load
+bool MergeLoader::expand(const vector<string>& arguments) {
+	boost::system::error_code failure;
+	fs::path path, folder;
+	string pattern;
+
+	for (const string& argument : arguments) {
+		path = fs::path(argument);
+		pattern = path.filename().string();
+
+		if (fs::is_directory(path, failure)) {
+			for (fs::directory_iterator entry(path, failure), end; entry != end; entry.increment(failure)) {
+				if (fs::is_regular_file(entry->path(), failure)) {
+					files.push_back(entry->path().string());
+				}
+			}
+		}
+		else if (pattern.find_first_of("*?") != string::npos) {
+			folder = path.has_parent_path() ? path.parent_path() : fs::path(".");
+
+			for (fs::directory_iterator entry(folder, failure), end; entry != end; entry.increment(failure)) {
+				if (fs::is_regular_file(entry->path(), failure) &&
+					wildcard_match(entry->path().filename().string(), pattern)) {
+					files.push_back(entry->path().string());
+				}
+			}
+		}
+		else if (fs::is_regular_file(path, failure)) {
+			files.push_back(argument);
+		}
+		else {
+			cerr << "Error: Could not find " << argument << endl;
+			return false;
+		}
+	}
+
+	sort(files.begin(), files.end());
+	files.erase(unique(files.begin(), files.end()), files.end());
+	return true;
+}
+
+//reads every reading of a file along with the spellings of its
+//coordinate. Compressed files are read the same way the loader reads them.
+//Returns false, with the line printed, on the first line that does not parse
+bool MergeLoader::parse_file(const string& path, vector<ParsedReading>& parsed) {
+	ifstream file;
+	boost::iostreams::filtering_istream in;
+	ParsedReading reading;
+	string line;
+	size_t number = 0;
+
+	if (IngestPipeline::open_source(path, file, in) < 0) {
+		return false;
+	}
+
+	while (getline(in, line)) {
+		number++;
+
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty()) {
+			continue;
+		}
+
+		reading.node = new Node;
+		reading.node->location_info = new Location;
+
+		try {
+			graph->parseCommand(&line, reading.node);
+		}
+		catch (exception&) {
+			cerr << "Error: Could not parse line " << number << " of " << path << ": " << line << endl;
+			delete reading.node->location_info;
+			delete reading.node;
+			return false;
+		}
+		reading.keys = Utility::permutations(reading.node->location_info->coordinate);
+		parsed.push_back(reading);
+	}
+
+	if (in.bad()) {
+		cerr << "Error: Could not read all of " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+//loads and merges every file. Returns false, with the reason printed, if
+//any of them could not be read, in which case nothing is added
+bool MergeLoader::load(const vector<string>& arguments) {
+	vector<vector<ParsedReading>> parsed;
+	vector<MergedReading> merged;
+	unordered_map<string, size_t> slots;
+	vector<thread> workers;
+	atomic<size_t> next(0);
+	atomic<bool> failed(false);
+	MergedReading entry;
+
+	if (!expand(arguments) || files.empty()) {
+		return false;
+	}
+
+	parsed.resize(files.size());
+	auto start = merge_clock::now();
+
+	//workers take the next unread file until there are none left
+	for (size_t i = 0; i < min(Utility::thread_count(), files.size()); i++) {
+		workers.push_back(thread([&]() {
+			size_t file;
+
+			while ((file = next++) < files.size()) {
+				//the decompressors throw on bad data
+				try {
+					if (!parse_file(files[file], parsed[file])) {
+						failed = true;
+					}
+				}
+				catch (exception& failure) {
+					cerr << "Error: Could not read all of " << files[file] << ": " << failure.what() << endl;
+					failed = true;
+				}
+			}
+		}));
+	}
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	parse_ms = since(start);
+
+	if (failed) {
+		for (vector<ParsedReading>& file : parsed) {
+			for (ParsedReading& reading : file) {
+				delete reading.node->location_info;
+				delete reading.node;
+			}
+		}
+		return false;
+	}
+
+	//the smallest spelling of a coordinate stands for all of them
+	start = merge_clock::now();
+
+	for (vector<ParsedReading>& file : parsed) {
+		for (ParsedReading& reading : file) {
+			auto slot = slots.insert(pair<string, size_t>(*reading.keys.begin(), merged.size()));
+			const vector<int>& channels = reading.node->location_info->channels;
+
+			readings++;
+
+			if (slot.second) {
+				entry.first = reading;
+				entry.chosen = reading.node;
+				entry.sum = reading.node->val;
+				entry.channel_sums.assign(channels.begin(), channels.end());
+				entry.count = 1;
+				merged.push_back(entry);
+				continue;
+			}
+
+			MergedReading& existing = merged[slot.first->second];
+
+			if (rule == MERGE_LAST || (rule == MERGE_MAX && reading.node->val > existing.chosen->val)) {
+				existing.chosen = reading.node;
+			}
+
+			existing.sum += reading.node->val;
+			existing.channel_sums.resize(max(existing.channel_sums.size(), channels.size()), 0);
+
+			for (size_t c = 0; c < channels.size(); c++) {
+				existing.channel_sums[c] += channels[c];
+			}
+			existing.count++;
+		}
+	}
+
+	for (MergedReading& reading : merged) {
+		choose(reading);
+	}
+
+	//only the first reading of each coordinate is kept as a node
+	for (vector<ParsedReading>& file : parsed) {
+		for (ParsedReading& reading : file) {
+			if (merged[slots[*reading.keys.begin()]].first.node != reading.node) {
+				delete reading.node->location_info;
+				delete reading.node;
+			}
+		}
+	}
+	merge_ms = since(start);
+
+	start = merge_clock::now();
+
+	for (MergedReading& reading : merged) {
+		graph->insert(reading.first.node, reading.first.keys);
+	}
+
+	insert_ms = since(start);
+	coordinates = merged.size();
+	return true;
+}
+
+//settles the value and channels the coordinate goes into the graph with,
+//carried on the node it was first read with
+void MergeLoader::choose(MergedReading& reading) {
+	Node* node = reading.first.node;
+	vector<int>& channels = node->location_info->channels;
+
+	if (rule == MERGE_MEAN) {
+		node->val = (int)llround(double(reading.sum) / reading.count);
+		channels.resize(reading.channel_sums.size());
+
+		for (size_t c = 0; c < channels.size(); c++) {
+			channels[c] = (int)llround(double(reading.channel_sums[c]) / reading.count);
+		}
+	}
+	else if (reading.chosen != node) {
+		node->val = reading.chosen->val;
+		channels = reading.chosen->location_info->channels;
+	}
+}
+
+void MergeLoader::print_report() {
+	const char* rules[] = { "last reading wins", "largest reading wins", "mean of the readings" };
+
+	cout << "Merged " << readings << " readings from " << files.size() << " files into " <<
+		coordinates << " coordinates (" << rules[rule] << ")" << endl;
+	cout << "Parsed in " << parse_ms << " ms, merged in " << merge_ms << " ms, inserted in " <<
+		insert_ms << " ms (" << (parse_ms + merge_ms + insert_ms > 0 ?
+			readings / (parse_ms + merge_ms + insert_ms) * 1000 : 0) << " readings/s)" << endl;
+}
@@ -0,0 +1,46 @@
+#ifndef MERGELOADER_H
+#define MERGELOADER_H
+
+#include "IngestPipeline.h"
+
+#define MERGE_LAST 0
+#define MERGE_MAX 1
+#define MERGE_MEAN 2
+
+//every reading of one coordinate across all of the files
+struct MergedReading {
+	ParsedReading first;
+	Node* chosen;
+	long long sum;
+	vector<long long> channel_sums;
+	int count;
+};
+
+//loads many survey files into one graph. Arguments may be files,
+//directories (every file directly inside) or names with * and ? in the
+//file part. The files are put in name order and parsed concurrently, then
+//merged on one thread in that order so the result never depends on how
+//the threads ran. A coordinate read more than once, under any spelling,
+//keeps the last reading (the latest file, then the latest line), the
+//largest, or the mean of all of them
+class MergeLoader {
+
+public:
+	MergeLoader(RadiationGraph*, int);
+	bool load(const vector<string>&);
+	void print_report();
+	static int parse_rule(const string&);
+
+private:
+	RadiationGraph* graph;
+	int rule;
+	vector<string> files;
+	size_t readings = 0, coordinates = 0;
+	double parse_ms = 0, merge_ms = 0, insert_ms = 0;
+
+	bool expand(const vector<string>&);
+	bool parse_file(const string&, vector<ParsedReading>&);
+	void choose(MergedReading&);
+};
+
+#endif // !MERGELOADER_H
@@ -0,0 +1,210 @@
+//NodeColumns.cpp
+#include "stdafx.h"
+#include "NodeColumns.h"
+#include "Utility.h"
+#include <algorithm>
+
+//Columnar view of the 3D graph.  The pointer based nodes remain the
+//source of truth, this is rebuilt from them whenever the structure
+//changes and patched in place when only a value does
+
+//lays out every indexed node in z-order. Each node remembers its
+//index so that neighbor references can be turned into column indices.
+//weights (one per channel) pick what goes in the values column, none
+//at all means the primary reading
+void NodeColumns::build(const multimap<uint64_t, Node*>& index, const size_t channel_count,
+	const vector<double>& weights) {
+	uint32_t id = 0;
+	Position pos;
+
+	clear();
+	nodes.reserve(index.size());
+	values.reserve(index.size());
+	x.reserve(index.size());
+	y.reserve(index.size());
+	z.reserve(index.size());
+	keys.reserve(index.size());
+
+	for (auto &entry : index) {
+		pos = Utility::morton_decode(entry.first);
+
+		entry.second->id = id++;
+		nodes.push_back(entry.second);
+		values.push_back(entry.second->val);
+		x.push_back(pos.x);
+		y.push_back(pos.y);
+		z.push_back(pos.z);
+		keys.push_back(entry.first);
+	}
+
+	vector<uint32_t>* columns[] = { &north, &south, &east, &west, &ascend, &descend };
+
+	for (vector<uint32_t>* column : columns) {
+		column->resize(nodes.size(), NO_NEIGHBOR);
+	}
+
+	//neighbors outside of the index keep NO_NEIGHBOR
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		Node* refs[] = { nodes[i]->north, nodes[i]->south, nodes[i]->east,
+			nodes[i]->west, nodes[i]->ascend, nodes[i]->descend };
+
+		for (int dir = 0; dir < 6; dir++) {
+			if (refs[dir] != nullptr && refs[dir]->id < nodes.size() &&
+				nodes[refs[dir]->id] == refs[dir]) {
+				(*columns[dir])[i] = refs[dir]->id;
+			}
+		}
+	}
+
+	if (channel_count > 1 || !weights.empty()) {
+		channels.assign(max(channel_count, size_t(1)), vector<int>(nodes.size(), 0));
+
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			channels[0][i] = values[i];
+
+			for (size_t chan = 1; chan < channel_count &&
+				chan <= nodes[i]->location_info->channels.size(); chan++) {
+				channels[chan][i] = nodes[i]->location_info->channels[chan - 1];
+			}
+		}
+	}
+
+	if (!weights.empty()) {
+		mix_channels(weights);
+	}
+}
+
+//replaces the values column with the weighted sum of the channels. The
+//sum is built one channel at a time over plain arrays so the inner loop
+//is a straight multiply add the compiler can vectorize
+void NodeColumns::mix_channels(const vector<double>& weights) {
+	vector<float> mixed(nodes.size(), 0.0f);
+	const int* source;
+	float* target = mixed.data();
+	float weight;
+	size_t count = nodes.size();
+
+	for (size_t chan = 0; chan < weights.size() && chan < channels.size(); chan++) {
+		if (weights[chan] == 0) {
+			continue;
+		}
+
+		source = channels[chan].data();
+		weight = float(weights[chan]);
+		for (size_t i = 0; i < count; i++) {
+			target[i] += weight * source[i];
+		}
+	}
+
+	//vacant nodes stay vacant no matter the mix
+	for (size_t i = 0; i < count; i++) {
+		if (values[i] != VACANT) {
+			values[i] = max(int(lround(target[i])), 0);
+		}
+	}
+}
+
+//mixes the channels of a single node again after one of them was patched,
+//adding them up in the same order as mix_channels so the value comes out
+//the same as a full rebuild would give
+void NodeColumns::remix(uint32_t index, const vector<double>& weights) {
+	float total = 0.0f;
+
+	for (size_t chan = 0; chan < weights.size() && chan < channels.size(); chan++) {
+		if (weights[chan] != 0) {
+			total += float(weights[chan]) * channels[chan][index];
+		}
+	}
+
+	values[index] = channels[0][index] == VACANT ? VACANT : max(int(lround(total)), 0);
+}
+
+//the sum of every non vacant node's reading in each channel
+vector<long long> NodeColumns::channel_totals() const {
+	vector<long long> totals;
+	const int* source;
+	long long total;
+
+	//only the primary reading is held, it is the values column
+	if (channels.empty()) {
+		total = 0;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			total += values[i] == VACANT ? 0 : values[i];
+		}
+		totals.push_back(total);
+		return totals;
+	}
+
+	for (size_t chan = 0; chan < channels.size(); chan++) {
+		source = channels[chan].data();
+		total = 0;
+
+		for (size_t i = 0; i < nodes.size(); i++) {
+			total += values[i] == VACANT ? 0 : source[i];
+		}
+		totals.push_back(total);
+	}
+	return totals;
+}
+
+//returns the neighbor column associated with one of the directionals
+const vector<uint32_t>& NodeColumns::links(const char direct) const {
+	switch (direct) {
+	case NORTH: return north;
+	case SOUTH: return south;
+	case EAST: return east;
+	case WEST: return west;
+	case ASCEND: return ascend;
+	default: return descend;
+	}
+}
+
+//distance between two nodes along the grid. Neighbors only ever
+//differ along a single axis so this is the distance in that direction
+uint32_t NodeColumns::distance(uint32_t from, uint32_t to) const {
+	return abs(x[from] - x[to]) + abs(y[from] - y[to]) + abs(z[from] - z[to]);
+}
+
+//appends the index of every node inside of the box spanned by low and
+//high (low being the smaller corner). The key column is sorted so the
+//scan is a binary search plus BIGMIN jumps over keys outside of the box
+void NodeColumns::in_box(const Position& low, const Position& high, vector<uint32_t>& inside) const {
+	uint64_t low_key = Utility::morton_encode(low), high_key = Utility::morton_encode(high), next;
+	size_t curr = lower_bound(keys.begin(), keys.end(), low_key) - keys.begin();
+	Position pos;
+
+	while (curr < keys.size() && keys[curr] <= high_key) {
+		pos.x = x[curr];
+		pos.y = y[curr];
+		pos.z = z[curr];
+
+		if (Utility::in_box(pos, low, high)) {
+			inside.push_back(uint32_t(curr));
+			curr++;
+		}
+		else if ((next = Utility::morton_bigmin(keys[curr], low_key, high_key)) > keys[curr]) {
+			curr = lower_bound(keys.begin() + curr, keys.end(), next) - keys.begin();
+		}
+		else {
+			break;
+		}
+	}
+}
+
+size_t NodeColumns::size() const { return nodes.size(); }
+
+//the number of bytes each node occupies across all of the columns
+size_t NodeColumns::bytes_per_node() const {
+	return sizeof(int) + 6 * sizeof(uint32_t) + 3 * sizeof(int32_t) + sizeof(uint64_t) +
+		sizeof(Node*);
+}
+
+void NodeColumns::clear() {
+	values.clear();
+	north.clear(); south.clear(); east.clear();
+	west.clear(); ascend.clear(); descend.clear();
+	channels.clear();
+	x.clear(); y.clear(); z.clear();
+	keys.clear();
+	nodes.clear();
+}
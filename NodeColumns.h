@@ -0,0 +1,45 @@
+#ifndef NODECOLUMNS_H
+#define NODECOLUMNS_H
+
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#define NO_NEIGHBOR UINT32_MAX
+
+using namespace std;
+
+struct Node;
+struct Position;
+
+//structure of arrays copy of the graph.  Each node is given a 32 bit index
+//(its position along the z-order curve) and every field the analysis passes
+//touch is stored in its own column so scans only load what they use.
+//values holds what the analyses run over, either the primary reading or a
+//weighted mix of the channels, which each get a column of their own when
+//there is more than one
+class NodeColumns {
+
+public:
+	vector<int> values;
+	vector<vector<int>> channels;
+	vector<uint32_t> north, south, east, west, ascend, descend;
+	vector<int32_t> x, y, z;
+	vector<uint64_t> keys;
+	vector<Node*> nodes;
+
+	void build(const multimap<uint64_t, Node*>&, const size_t, const vector<double>&);
+	void remix(uint32_t, const vector<double>&);
+	vector<long long> channel_totals() const;
+	const vector<uint32_t>& links(const char) const;
+	uint32_t distance(uint32_t, uint32_t) const;
+	void in_box(const Position&, const Position&, vector<uint32_t>&) const;
+	size_t size() const;
+	size_t bytes_per_node() const;
+	void clear();
+
+private:
+	void mix_channels(const vector<double>&);
+};
+
+#endif // !NODECOLUMNS_H
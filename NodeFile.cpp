@@ -0,0 +1,689 @@
+//NodeFile.cpp
+#include "stdafx.h"
+#include "NodeFile.h"
+#include "IngestPipeline.h"
+#include "Utility.h"
+#include <chrono>
+#include <cstring>
+#include <queue>
+#include <algorithm>
+
+//Building from survey files never holds more than NODEFILE_RUN readings:
+//they are sorted into runs on disk which are then merged straight into the
+//node file, later readings of a coordinate replacing earlier ones. The
+//neighbors are linked afterwards, walking the file in order and looking
+//each one up by key, and every link is written from both ends
+
+#define VAL_OFFSET 8
+#define LINK_OFFSET 16
+
+typedef chrono::high_resolution_clock nodefile_clock;
+
+static double since(const nodefile_clock::time_point& start) {
+	return chrono::duration<double, milli>(nodefile_clock::now() - start).count();
+}
+
+static uint64_t record_key(const char* rec) {
+	uint64_t key;
+
+	memcpy(&key, rec, sizeof(key));
+	return key;
+}
+
+static int record_val(const char* rec) {
+	int val;
+
+	memcpy(&val, rec + VAL_OFFSET, sizeof(val));
+	return val;
+}
+
+NodeFile::NodeFile() {}
+
+NodeFile::~NodeFile() {
+	flush();
+}
+
+//reads a survey line into a key and value. Returns false for blank lines
+bool NodeFile::parse(string* command, RunEntry& entry) {
+	Node node;
+
+	if (command->empty()) {
+		return false;
+	}
+
+	node.location_info = new Location;
+	RadiationGraph::parseCommand(command, &node);
+	entry.key = Utility::morton_encode(Utility::resolve(node.location_info));
+	entry.val = node.val;
+	delete node.location_info;
+	return true;
+}
+
+//sorts a run by key and writes it out with only the last reading of each
+//coordinate
+bool NodeFile::spill_run(vector<RunEntry>& run, const string& run_path) {
+	ofstream out(run_path, ios::out | ios::binary | ios::trunc);
+	size_t kept = 0;
+
+	stable_sort(run.begin(), run.end(), [](const RunEntry& a, const RunEntry& b) {
+		return a.key < b.key;
+	});
+
+	for (size_t i = 0; i < run.size(); i++) {
+		if (i + 1 < run.size() && run[i + 1].key == run[i].key) {
+			continue;
+		}
+		run[kept++] = run[i];
+	}
+
+	out.write((const char*)run.data(), kept * sizeof(RunEntry));
+	run.clear();
+	return out.good();
+}
+
+//builds a node file out of survey files, plain or compressed
+bool NodeFile::build(const vector<string>& inputs, const string& file_path) {
+	vector<RunEntry> run;
+	vector<string> runs;
+	vector<ifstream> readers;
+	uint64_t bound = 0;
+	RunEntry entry;
+	string line;
+	bool built;
+
+	auto start = nodefile_clock::now();
+	run.reserve(NODEFILE_RUN);
+
+	for (const string& input : inputs) {
+		ifstream file;
+		boost::iostreams::filtering_istream in;
+
+		if (IngestPipeline::open_source(input, file, in) < 0) {
+			return false;
+		}
+
+		while (getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!parse(&line, entry)) {
+				continue;
+			}
+
+			run.push_back(entry);
+			bound++;
+
+			if (run.size() == NODEFILE_RUN) {
+				runs.push_back(file_path + ".run" + std::to_string(runs.size()));
+
+				if (!spill_run(run, runs.back())) {
+					cerr << "Error: Could not write " << runs.back() << endl;
+					return false;
+				}
+			}
+		}
+	}
+
+	runs.push_back(file_path + ".run" + std::to_string(runs.size()));
+
+	if (!spill_run(run, runs.back())) {
+		cerr << "Error: Could not write " << runs.back() << endl;
+		return false;
+	}
+	vector<RunEntry>().swap(run);
+
+	//merge the runs, the latest run winning between equal keys
+	typedef pair<uint64_t, size_t> Head;
+	priority_queue<Head, vector<Head>, greater<Head>> heads;
+	vector<RunEntry> current(runs.size());
+
+	for (size_t i = 0; i < runs.size(); i++) {
+		readers.push_back(ifstream(runs[i], ios::in | ios::binary));
+
+		if (readers[i].read((char*)&current[i], sizeof(RunEntry))) {
+			heads.push(Head(current[i].key, i));
+		}
+	}
+
+	built = write_records([&](RunEntry& next, uint64_t*) {
+		size_t source;
+
+		if (heads.empty()) {
+			return false;
+		}
+
+		next.key = heads.top().first;
+
+		while (!heads.empty() && heads.top().first == next.key) {
+			source = heads.top().second;
+			next.val = current[source].val;
+			heads.pop();
+
+			if (readers[source].read((char*)&current[source], sizeof(RunEntry))) {
+				heads.push(Head(current[source].key, source));
+			}
+		}
+		return true;
+	}, bound, file_path, false);
+
+	for (size_t i = 0; i < runs.size(); i++) {
+		readers[i].close();
+		remove(runs[i].c_str());
+	}
+
+	if (!built || !open(file_path)) {
+		cerr << "Error: Could not write " << file_path << endl;
+		return false;
+	}
+
+	cout << "Built " << file_path << " with " << count << " readings from " << inputs.size() <<
+		" files and " << runs.size() << " sorted runs in " << since(start) << " ms" << endl;
+	return true;
+}
+
+//writes records from a key ordered source, which may fill in the links of
+//each record and otherwise leaves them empty. bound is the most records
+//there could be, which settles the index width. linked marks the file as
+//having its links in place
+bool NodeFile::write_records(const function<bool(RunEntry&, uint64_t*)>& next, uint64_t bound,
+	const string& out_path, bool linked) {
+
+	vector<char> buffer(1 << 20);
+	NodeFileHeader header = { NODEFILE_MAGIC, NODEFILE_VERSION, 4, linked ? 1u : 0u, 0 };
+	char padding[NODEFILE_HEADER] = { 0 };
+	uint64_t links[NODEFILE_LINKS];
+	uint32_t narrow;
+	vector<char> rec;
+	RunEntry entry;
+	ofstream out;
+
+	out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	out.open(out_path, ios::out | ios::binary | ios::trunc);
+
+	if (bound >= UINT32_MAX) {
+		header.index_bytes = 8;
+	}
+
+	rec.assign(LINK_OFFSET + NODEFILE_LINKS * header.index_bytes, 0);
+	out.write(padding, NODEFILE_HEADER);
+
+	while (true) {
+		fill(links, links + NODEFILE_LINKS, NO_LINK);
+
+		if (!next(entry, links)) {
+			break;
+		}
+
+		memcpy(rec.data(), &entry.key, sizeof(entry.key));
+		memcpy(rec.data() + VAL_OFFSET, &entry.val, sizeof(entry.val));
+
+		for (int direction = 0; direction < NODEFILE_LINKS; direction++) {
+			if (header.index_bytes == 4) {
+				narrow = links[direction] == NO_LINK ? UINT32_MAX : (uint32_t)links[direction];
+				memcpy(rec.data() + LINK_OFFSET + direction * 4, &narrow, 4);
+			}
+			else {
+				memcpy(rec.data() + LINK_OFFSET + direction * 8, &links[direction], 8);
+			}
+		}
+		out.write(rec.data(), rec.size());
+		header.count++;
+	}
+
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	out.close();
+	return !out.fail();
+}
+
+//maps a node file in and links it up if it has not been already
+bool NodeFile::open(const string& file_path) {
+	NodeFileHeader header;
+	ifstream in(file_path, ios::in | ios::binary);
+
+	if (!in.read((char*)&header, sizeof(header)) || header.magic != NODEFILE_MAGIC ||
+		header.version != NODEFILE_VERSION) {
+		cerr << "Error: " << file_path << " is not a node file" << endl;
+		return false;
+	}
+	in.close();
+
+	path = file_path;
+	count = header.count;
+	index_bytes = header.index_bytes;
+	record_bytes = LINK_OFFSET + NODEFILE_LINKS * index_bytes;
+
+	if (!records.open(path, NODEFILE_HEADER, NODEFILE_WINDOW_RECORDS * record_bytes, true)) {
+		cerr << "Error: Could not map " << path << endl;
+		return false;
+	}
+
+	//header.reserved marks a file whose links are in place
+	if (header.reserved == 0) {
+		link_neighbors();
+	}
+	return true;
+}
+
+char* NodeFile::record(uint64_t index) {
+	return records.window(index / NODEFILE_WINDOW_RECORDS) +
+		(index % NODEFILE_WINDOW_RECORDS) * record_bytes;
+}
+
+//the index of the first record with a key no lower than the given one
+uint64_t NodeFile::position(uint64_t key) {
+	uint64_t low = 0, high = count, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+
+		if (record_key(record(mid)) < key) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+//the index of the record with the key, or NO_LINK
+uint64_t NodeFile::search(uint64_t key) {
+	uint64_t low = position(key);
+
+	return low < count && record_key(record(low)) == key ? low : NO_LINK;
+}
+
+uint64_t NodeFile::get_link(const char* rec, int direction) const {
+	uint32_t narrow;
+	uint64_t wide;
+
+	if (index_bytes == 4) {
+		memcpy(&narrow, rec + LINK_OFFSET + direction * 4, 4);
+		return narrow == UINT32_MAX ? NO_LINK : narrow;
+	}
+
+	memcpy(&wide, rec + LINK_OFFSET + direction * 8, 8);
+	return wide;
+}
+
+void NodeFile::set_link(char* rec, int direction, uint64_t index) {
+	uint32_t narrow = (uint32_t)index;
+
+	if (index_bytes == 4) {
+		memcpy(rec + LINK_OFFSET + direction * 4, &narrow, 4);
+	}
+	else {
+		memcpy(rec + LINK_OFFSET + direction * 8, &index, 8);
+	}
+}
+
+//finds the nearest reading north, east and above every record and links
+//both ways. The file is marked as linked once done
+void NodeFile::link_neighbors() {
+	const int steps[3][3] = { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } };
+	NodeFileHeader header;
+	Position pos, probe;
+	uint64_t neighbor;
+
+	auto start = nodefile_clock::now();
+
+	for (uint64_t i = 0; i < count; i++) {
+		pos = Utility::morton_decode(record_key(record(i)));
+
+		//north, east and ascend are the even directions, the odd ones their
+		//opposites
+		for (int axis = 0; axis < 3; axis++) {
+			for (int reach = 1; reach <= NODEFILE_LINK_REACH; reach++) {
+				probe.x = pos.x + steps[axis][0] * reach;
+				probe.y = pos.y + steps[axis][1] * reach;
+				probe.z = pos.z + steps[axis][2] * reach;
+
+				if ((neighbor = search(Utility::morton_encode(probe))) != NO_LINK) {
+					set_link(record(i), 2 * axis, neighbor);
+					set_link(record(neighbor), 2 * axis + 1, i);
+					break;
+				}
+			}
+		}
+	}
+
+	records.close();
+
+	{
+		fstream out(path, ios::in | ios::out | ios::binary);
+
+		out.read((char*)&header, sizeof(header));
+		header.reserved = 1;
+		out.seekp(0);
+		out.write((const char*)&header, sizeof(header));
+	}
+
+	records.open(path, NODEFILE_HEADER, NODEFILE_WINDOW_RECORDS * record_bytes, true);
+
+	cout << "Linked " << count << " readings in " << since(start) << " ms (" << records.get_maps() <<
+		" windows mapped)" << endl;
+}
+
+//links each of the given records, by index, to the nearest reading in all
+//six directions and those readings back to it. Anything further away that
+//one of them was linked to before lies beyond the record now
+void NodeFile::link_folded(const vector<uint64_t>& folded) {
+	const int steps[3][3] = { { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } };
+	Position pos, probe;
+	uint64_t neighbor;
+	int sign;
+
+	for (uint64_t i : folded) {
+		pos = Utility::morton_decode(record_key(record(i)));
+
+		for (int direction = 0; direction < NODEFILE_LINKS; direction++) {
+			sign = direction % 2 == 0 ? 1 : -1;
+
+			for (int reach = 1; reach <= NODEFILE_LINK_REACH; reach++) {
+				probe.x = pos.x + steps[direction / 2][0] * reach * sign;
+				probe.y = pos.y + steps[direction / 2][1] * reach * sign;
+				probe.z = pos.z + steps[direction / 2][2] * reach * sign;
+
+				if ((neighbor = search(Utility::morton_encode(probe))) != NO_LINK) {
+					set_link(record(i), direction, neighbor);
+					set_link(record(neighbor), direction ^ 1, i);
+					break;
+				}
+			}
+		}
+	}
+}
+
+//overwrites the value in place if the coordinate is on file, otherwise
+//holds the reading until the next fold
+void NodeFile::add(string* command) {
+	RunEntry entry;
+	uint64_t index;
+
+	if (!parse(command, entry)) {
+		return;
+	}
+
+	if ((index = search(entry.key)) != NO_LINK) {
+		memcpy(record(index) + VAL_OFFSET, &entry.val, sizeof(entry.val));
+		return;
+	}
+
+	pending[entry.key] = entry.val;
+
+	if (pending.size() >= NODEFILE_PENDING) {
+		flush();
+	}
+}
+
+//whether the coordinate is held and has a value, as in_graph reports it
+Found NodeFile::find(string* command) {
+	Found status = { false, false };
+	RunEntry entry;
+	uint64_t index;
+
+	if (!parse(command, entry)) {
+		return status;
+	}
+
+	auto held = pending.find(entry.key);
+
+	if (held != pending.end()) {
+		status.has_node = true;
+		status.has_value = held->second != VACANT;
+	}
+	else if ((index = search(entry.key)) != NO_LINK) {
+		status.has_node = true;
+		status.has_value = record_val(record(index)) != VACANT;
+	}
+	return status;
+}
+
+uint64_t NodeFile::size() const { return count + pending.size(); }
+
+//rewrites the file with the waiting readings merged in. A record already
+//on file moves up by the number of new coordinates ahead of it, found from
+//where each of them goes in the old file, and keeps its links moved up the
+//same way. The new records are linked afterwards
+void NodeFile::flush() {
+	const string rewritten = path + ".new", previous = path + ".old";
+	auto held = pending.begin();
+	vector<uint64_t> inserted, folded;
+	uint64_t next_record = 0, link;
+	bool written;
+	const char* rec;
+
+	if (pending.empty() || path.empty()) {
+		return;
+	}
+
+	auto start = nodefile_clock::now();
+
+	//add overwrites readings on file in place, so every held key is new
+	for (auto& reading : pending) {
+		inserted.push_back(position(reading.first));
+	}
+
+	written = write_records([&](RunEntry& next, uint64_t* links) {
+		uint64_t key = next_record < count ? record_key(record(next_record)) : UINT64_MAX;
+
+		if (held != pending.end() && held->first <= key) {
+			next.key = held->first;
+			next.val = held->second;
+			++held;
+			return true;
+		}
+		if (next_record < count) {
+			rec = record(next_record++);
+			next.key = key;
+			next.val = record_val(rec);
+
+			for (int direction = 0; direction < NODEFILE_LINKS; direction++) {
+				if ((link = get_link(rec, direction)) != NO_LINK) {
+					links[direction] = link + (upper_bound(inserted.begin(), inserted.end(), link) -
+						inserted.begin());
+				}
+			}
+			return true;
+		}
+		return false;
+	}, count + pending.size(), rewritten, true);
+
+	records.close();
+
+	//the old file is moved aside rather than removed so that it can be put
+	//back if the new one cannot take its place. Either way a failed fold
+	//maps the old file in again and keeps the readings waiting
+	if (!written || rename(path.c_str(), previous.c_str()) != 0) {
+		remove(rewritten.c_str());
+		cerr << "Error: Could not rewrite " << path << endl;
+		open(path);
+		return;
+	}
+	if (rename(rewritten.c_str(), path.c_str()) != 0) {
+		rename(previous.c_str(), path.c_str());
+		remove(rewritten.c_str());
+		cerr << "Error: Could not rewrite " << path << endl;
+		open(path);
+		return;
+	}
+	remove(previous.c_str());
+
+	pending.clear();
+
+	if (!open(path)) {
+		return;
+	}
+
+	//the m-th new record has the m new records before it ahead of it too
+	for (size_t m = 0; m < inserted.size(); m++) {
+		folded.push_back(inserted[m] + m);
+	}
+	link_folded(folded);
+
+	cout << "Folded " << folded.size() << " readings into " << count << " in " << since(start) << " ms" << endl;
+}
+
+//streams the values in file order into the same bins as display_histogram
+void NodeFile::print_histogram() {
+	int hist[MAX_BINS] = { 0 };
+	uint64_t vacants = 0, outside = 0, total = 0;
+	map<int, int> value_occurrences;
+	unsigned long long maps;
+	int val;
+
+	flush();
+	maps = records.get_maps();
+	auto start = nodefile_clock::now();
+
+	for (uint64_t i = 0; i < count; i++) {
+		val = record_val(record(i));
+
+		if (val != VACANT && val >= 0 && val < MAX_BINS) {
+			hist[val]++;
+		}
+		else if (val != VACANT) {
+			outside++;
+		}
+		else {
+			vacants++;
+		}
+		total++;
+	}
+
+	double elapsed = since(start);
+
+	for (int i = 0; i < MAX_BINS; i++) {
+		if (hist[i] != 0) {
+			cout << "Value " << i << " occurred " << hist[i] << " times which is "
+				<< (float)hist[i] / total << "%" << endl;
+			value_occurrences.insert(pair<int, int>(i, hist[i]));
+		}
+	}
+
+	if (vacants != 0) {
+		cout << "With " << vacants << " empty nodes which is " << (float)vacants / total << " %" << endl;
+	}
+	if (outside != 0) {
+		cout << "With " << outside << " values past the last bin" << endl;
+	}
+
+	cout << Utility::distribution_type(value_occurrences) << "\n" << endl;
+	cout << "Streamed " << total << " records of " << record_bytes << " bytes in " << elapsed <<
+		" ms through " << records.get_maps() - maps << " window maps\n" << endl;
+}
+
+//groups readings joined by links no longer than dist, the same rule the
+//in memory clustering follows. The union find forest lives in a mapped
+//file of its own beside the node file, a root holding minus its size
+void NodeFile::print_clusters(const int dist) {
+	const string forest_path = path + ".clusters";
+	const size_t per_window = 1 << 18;
+	const int directions[] = { 0, 2, 4 };
+	MappedFile forest;
+	vector<pair<int64_t, uint64_t>> largest;
+	uint64_t clusters = 0, neighbor;
+	int64_t root_a, root_b;
+	Position pos, other;
+	const char* rec;
+
+	if (dist <= 0) {
+		cout << "Invalid distance " << dist << endl;
+		return;
+	}
+
+	flush();
+	auto start = nodefile_clock::now();
+
+	if (count == 0 || !forest.create(forest_path, count * sizeof(int64_t), 0, per_window * sizeof(int64_t))) {
+		cout << "No clusters of size " << dist << " were found." << endl;
+		return;
+	}
+
+	auto parent = [&](uint64_t i) {
+		return (int64_t*)forest.window(i / per_window) + i % per_window;
+	};
+
+	//path halving, every node on the way is pointed at its grandparent
+	auto find = [&](int64_t i) {
+		int64_t up, above;
+
+		while ((up = *parent(i)) >= 0) {
+			if ((above = *parent(up)) >= 0) {
+				*parent(i) = above;
+				i = above;
+			}
+			else {
+				i = up;
+			}
+		}
+		return i;
+	};
+
+	for (uint64_t i = 0; i < count; i++) {
+		*parent(i) = -1;
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		rec = record(i);
+
+		if (record_val(rec) == VACANT) {
+			continue;
+		}
+		pos = Utility::morton_decode(record_key(rec));
+
+		for (int direction : directions) {
+			if ((neighbor = get_link(record(i), direction)) == NO_LINK ||
+				record_val(record(neighbor)) == VACANT) {
+				continue;
+			}
+
+			other = Utility::morton_decode(record_key(record(neighbor)));
+
+			if (abs(other.x - pos.x) + abs(other.y - pos.y) + abs(other.z - pos.z) > dist ||
+				(root_a = find(i)) == (root_b = find(neighbor))) {
+				continue;
+			}
+
+			//the larger tree takes the smaller, the lower root on a tie
+			if (*parent(root_a) > *parent(root_b) ||
+				(*parent(root_a) == *parent(root_b) && root_a > root_b)) {
+				swap(root_a, root_b);
+			}
+			*parent(root_a) += *parent(root_b);
+			*parent(root_b) = root_a;
+		}
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		if (*parent(i) < -1) {
+			clusters++;
+			largest.push_back(pair<int64_t, uint64_t>(*parent(i), i));
+
+			if (largest.size() > 10) {
+				sort(largest.begin(), largest.end());
+				largest.pop_back();
+			}
+		}
+	}
+	sort(largest.begin(), largest.end());
+
+	if (clusters == 0) {
+		cout << "No clusters of size " << dist << " were found." << endl;
+	}
+	else {
+		cout << clusters << " clusters of two or more readings, the largest being" << endl;
+
+		for (auto& cluster : largest) {
+			pos = Utility::morton_decode(record_key(record(cluster.second)));
+			cout << " " << -cluster.first << " readings around " << pos.x << "," << pos.y << "," <<
+				pos.z << endl;
+		}
+	}
+
+	cout << "Clustered " << count << " records in " << since(start) << " ms\n" << endl;
+
+	forest.close();
+	remove(forest_path.c_str());
+}
@@ -0,0 +1,76 @@
+#ifndef NODEFILE_H
+#define NODEFILE_H
+
+#include "radiationgraph.h"
+#include "MappedFile.h"
+
+#define NODEFILE_MAGIC 0x4e4c5052
+#define NODEFILE_VERSION 1
+#define NODEFILE_HEADER 64
+#define NODEFILE_WINDOW_RECORDS (1 << 18)
+#define NODEFILE_RUN (1 << 22)
+#define NODEFILE_PENDING (1 << 16)
+#define NODEFILE_LINK_REACH 16
+#define NODEFILE_LINKS 6
+#define NO_LINK UINT64_MAX
+
+//the first bytes of a node file
+struct NodeFileHeader {
+	uint32_t magic, version, index_bytes, reserved;
+	uint64_t count;
+};
+
+//a reading waiting in a sorted run
+struct RunEntry {
+	uint64_t key;
+	int val;
+};
+
+//graph storage for surveys too large to hold as Nodes. Every reading is a
+//fixed size record in a memory mapped file, kept in z-order key order:
+//the key, the value and the indices of its six neighbors in the order
+//north, south, east, west, ascend, descend. Indices are 32 bit while the
+//file has fewer than 2^32 records and 64 bit past that. Only
+//MAPPED_RESIDENT windows of NODEFILE_WINDOW_RECORDS records are mapped at
+//a time so the memory used stays the same however large the file is.
+//
+//A neighbor is the nearest reading along an axis within NODEFILE_LINK_REACH.
+//New coordinates wait in memory, up to NODEFILE_PENDING of them, and are
+//then folded into a rewritten file in one sequential pass. The rewrite
+//carries every link over to the new indices, so only the folded readings
+//and the neighbors they come between are linked again
+class NodeFile {
+
+public:
+	NodeFile();
+	~NodeFile();
+	bool build(const vector<string>&, const string&);
+	bool open(const string&);
+	void add(string*);
+	Found find(string*);
+	uint64_t size() const;
+	void print_histogram();
+	void print_clusters(const int);
+	void flush();
+
+private:
+	string path;
+	MappedFile records;
+	uint64_t count = 0;
+	uint32_t index_bytes = 4;
+	size_t record_bytes = 0;
+	map<uint64_t, int> pending;
+
+	char* record(uint64_t);
+	uint64_t position(uint64_t);
+	uint64_t search(uint64_t);
+	uint64_t get_link(const char*, int) const;
+	void set_link(char*, int, uint64_t);
+	void link_neighbors();
+	void link_folded(const vector<uint64_t>&);
+	bool write_records(const function<bool(RunEntry&, uint64_t*)>&, uint64_t, const string&, bool);
+	static bool parse(string*, RunEntry&);
+	static bool spill_run(vector<RunEntry>&, const string&);
+};
+
+#endif // !NODEFILE_H
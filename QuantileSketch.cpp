@@ -0,0 +1,98 @@
+//QuantileSketch.cpp
+#include "stdafx.h"
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+
+QuantileSketch::QuantileSketch(unsigned seed) : random(seed) {}
+
+//values the given level may hold before it is compacted
+size_t QuantileSketch::capacity(size_t level) const {
+	return max((size_t)SKETCH_MIN_WIDTH,
+		(size_t)ceil(SKETCH_K * pow(2.0 / 3.0, (double)(levels.size() - 1 - level))));
+}
+
+void QuantileSketch::insert(int val) {
+	if (levels.empty()) {
+		levels.emplace_back();
+	}
+
+	levels[0].push_back(val);
+	n++;
+
+	if (levels[0].size() >= capacity(0)) {
+		compress();
+	}
+}
+
+//moves every other value of each full level up a level, doubling its
+//weight. With an odd count the smallest value stays behind so the total
+//weight never changes
+void QuantileSketch::compress() {
+	size_t odd, offset;
+	bool full = true;
+
+	while (full) {
+		full = false;
+
+		for (size_t h = 0; h < levels.size(); h++) {
+			if (levels[h].size() < capacity(h)) {
+				continue;
+			}
+			if (h + 1 == levels.size()) {
+				levels.emplace_back();
+			}
+
+			vector<int>& level = levels[h];
+
+			sort(level.begin(), level.end());
+			odd = level.size() % 2;
+			offset = random() & 1;
+
+			for (size_t i = odd + offset; i < level.size(); i += 2) {
+				levels[h + 1].push_back(level[i]);
+			}
+			level.resize(odd);
+			full = true;
+		}
+	}
+}
+
+//pools the other sketch's values into this one
+void QuantileSketch::merge(const QuantileSketch& other) {
+	while (levels.size() < other.levels.size()) {
+		levels.emplace_back();
+	}
+
+	for (size_t h = 0; h < other.levels.size(); h++) {
+		levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+	}
+	n += other.n;
+	compress();
+}
+
+unsigned long long QuantileSketch::count() const { return n; }
+
+//appends every value kept along with the number of values it stands for,
+//multiplied by sign
+void QuantileSketch::weighted_values(vector<pair<int, long long>>& values, const int sign) const {
+	for (size_t h = 0; h < levels.size(); h++) {
+		for (int val : levels[h]) {
+			values.push_back(pair<int, long long>(val, sign * (1LL << h)));
+		}
+	}
+}
+
+size_t QuantileSketch::retained() const {
+	size_t total = 0;
+
+	for (const vector<int>& level : levels) {
+		total += level.size();
+	}
+	return total;
+}
+
+void QuantileSketch::clear() {
+	levels.clear();
+	n = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#define SKETCH_K 200
+#define SKETCH_MIN_WIDTH 8
+#define SKETCH_RANK_ERROR 0.0165
+
+using namespace std;
+
+//KLL quantile sketch of a stream of values. Level h holds values that each
+//stand for 2^h of the values seen. When a level fills up it is sorted and
+//every other value, starting at random from the first or second, moves up
+//a level, so ranks stay unbiased and are off by at most about
+//SKETCH_RANK_ERROR of the count (k = SKETCH_K, 99% of the time) while only
+//a few hundred values are kept. Levels further down are kept smaller, each
+//2/3 of the one above it. Two sketches merge by pooling their levels
+class QuantileSketch {
+
+public:
+	QuantileSketch(unsigned = 1);
+	void insert(int);
+	void merge(const QuantileSketch&);
+	unsigned long long count() const;
+	void weighted_values(vector<pair<int, long long>>&, const int) const;
+	size_t retained() const;
+	void clear();
+
+private:
+	vector<vector<int>> levels;
+	unsigned long long n = 0;
+	mt19937 random;
+	size_t capacity(size_t) const;
+	void compress();
+};
+
+#endif // !QUANTILESKETCH_H
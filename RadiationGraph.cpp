@@ -19,6 +19,8 @@
 
 #include "stdafx.h"
 #include "Utility.h"
+#include <chrono>
+#include <numeric>
 #include "boost\foreach.hpp"
 #include "boost\lexical_cast.hpp"
 
@@ -35,11 +37,11 @@ RadiationGraph::RadiationGraph() {
 	centroid->location_info->distances.push_back(0);
 	centroid->location_info->coordinate = CENTROID;
 
-	knowledge_base.insert(pair<string, Node*>("CENTROID", centroid));
+	register_node("CENTROID", centroid);
 }
 
 //deallocate the entire 3D graph by removing locations
-//from the knowledge
+//from the knowledge. Nodes moved by defragment live in one block
 RadiationGraph::~RadiationGraph() {
 
 	Node* curr;
@@ -48,10 +50,14 @@ RadiationGraph::~RadiationGraph() {
 		curr = it->second;
 
 		delete curr->location_info;
-		delete curr;
+		if (!is_pooled(curr)) {
+			delete curr;
+		}
 
 		knowledge_base.erase(it++);
 	}
+
+	delete[] node_pool;
 }
 
 //return the amount of nodes created, nodes can be
@@ -62,16 +68,29 @@ size_t RadiationGraph::getSize() { return knowledge_base.size(); }
 //vacant in the graph
 int RadiationGraph::explicit_size()
 {
-	int empty_nodes = 0;
-	typedef pair<string, Node*> entry;
+	return parallel_reduce(0, [](int& empty_nodes, const NodeView& view) {
+		empty_nodes += view.value == VACANT;
+	}, [](int& total, const int& empty_nodes) {
+		total += empty_nodes;
+	});
+}
 
-	BOOST_FOREACH(entry curr, knowledge_base) {
-		if (curr.second->val == VACANT) {
-			empty_nodes++;
-		}
+//fills in the view of the node at an index of the column store
+void RadiationGraph::fill_view(NodeView& view, uint32_t index) const {
+	const vector<uint32_t>* links[] = { &columns.north, &columns.south, &columns.east,
+		&columns.west, &columns.ascend, &columns.descend };
+
+	view.index = index;
+	view.node = columns.nodes[index];
+	view.value = columns.values[index];
+	view.position.x = columns.x[index];
+	view.position.y = columns.y[index];
+	view.position.z = columns.z[index];
+
+	for (int i = 0; i < 6; i++) {
+		view.neighbors[i] = (*links[i])[index];
+		view.neighbor_values[i] = view.neighbors[i] == NO_NEIGHBOR ? VACANT : columns.values[view.neighbors[i]];
 	}
-
-	return empty_nodes;
 }
 
 //of some predefined distance, print out all of the
@@ -79,194 +98,419 @@ int RadiationGraph::explicit_size()
 //to the passed in size
 void RadiationGraph::print_cluster(const int dist) {
 
-	vector<set<Node*>> communities;
-	int counter = 1;
+	if (dist <= 0) {
+		cout << "Invalid distance " << dist << endl;
+	}
+	else {
+		print_communities(get_communities_of_size(dist, nullptr), dist);
+	}
+}
+
+//the clusters formed only by readings from low to high. The walk starts
+//from and expands over the readings in the range alone, so a high
+//threshold leaves most of the graph untouched
+void RadiationGraph::print_cluster_within(const int dist, const int low, const int high) {
+	RoaringBitmap mask;
 
 	if (dist <= 0) {
 		cout << "Invalid distance " << dist << endl;
+		return;
+	}
+
+	mask = readings_between(low, high);
+	print_communities(get_communities_of_size(dist, &mask), dist);
+}
+
+void RadiationGraph::print_communities(const vector<set<Node*>>& communities, const int dist) {
+	int counter = 1;
+
+	if (communities.size() != 0) {
+		//print out all of the clusters found
+		for each(set<Node*> cluster in communities) {
+			cout << "Cluster " << counter << endl;
+
+			for each(Node* curr in cluster) {
+				cout << to_string(curr);
+			}
+			cout << endl;
+			counter++;
+		}
 	}
 	else {
+		cout << "No clusters of size " << dist << " were found." << endl;
+	}
+}
 
-		communities = get_communities_of_size(dist);
+//the count, sum, mean, maximum, bounding box, centroid and peak of every
+//cluster at the given distance, taken over the same members print_cluster
+//lists and in the same order. The members of all the clusters are laid end
+//to end and split evenly between the workers, so one large cluster is
+//shared out like many small ones. Each worker sums up the parts of the
+//clusters in its share and the parts are joined in order afterwards
+vector<ClusterSummary> RadiationGraph::summarize_clusters(const int dist) {
+	struct Partial {
+		size_t cluster;
+		ClusterSummary summary;
+		long long weighted[3];
+		uint32_t peak;
+	};
+
+	vector<vector<uint32_t>> clusters;
+	vector<vector<Partial>> partials;
+	vector<Partial> totals;
+	vector<ClusterSummary> summaries;
+	vector<size_t> offsets(1, 0);
 
-		if (communities.size() != 0) {
-			//print out all of the clusters found
-			for each(set<Node*> cluster in communities) {
-				cout << "Cluster " << counter << endl;
+	if (dist <= 0) {
+		return summaries;
+	}
 
-				for each(Node* curr in cluster) {
-					cout << to_string(curr);
-				}
-				cout << endl;
-				counter++;
+	clusters = cluster_members(dist, nullptr);
+
+	for (const vector<uint32_t>& cluster : clusters) {
+		offsets.push_back(offsets.back() + cluster.size());
+	}
+
+	auto fresh = [](size_t cluster) {
+		return Partial{ cluster, ClusterSummary{ 0, 0, 0, VACANT, {}, {}, {}, nullptr }, {}, NO_NEIGHBOR };
+	};
+
+	auto join = [](Partial& into, const Partial& from) {
+		size_t cluster = into.cluster;
+
+		if (from.summary.count == 0) {
+			return;
+		}
+		if (into.summary.count == 0) {
+			into = from;
+			into.cluster = cluster;
+			return;
+		}
+
+		into.summary.count += from.summary.count;
+		into.summary.sum += from.summary.sum;
+		into.summary.low = Position{ min(into.summary.low.x, from.summary.low.x),
+			min(into.summary.low.y, from.summary.low.y), min(into.summary.low.z, from.summary.low.z) };
+		into.summary.high = Position{ max(into.summary.high.x, from.summary.high.x),
+			max(into.summary.high.y, from.summary.high.y), max(into.summary.high.z, from.summary.high.z) };
+
+		for (int axis = 0; axis < 3; axis++) {
+			into.weighted[axis] += from.weighted[axis];
+		}
+
+		if (from.summary.max > into.summary.max ||
+			(from.summary.max == into.summary.max && from.peak < into.peak)) {
+			into.summary.max = from.summary.max;
+			into.peak = from.peak;
+		}
+	};
+
+	partials.resize(Utility::thread_count());
+
+	Utility::parallel_for(offsets.back(), [&](size_t chunk, size_t begin, size_t end) {
+		size_t cluster = upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+		Partial part = fresh(cluster), member = fresh(cluster);
+		uint32_t index;
+
+		for (size_t i = begin; i < end; i++) {
+			while (i >= offsets[cluster + 1]) {
+				partials[chunk].push_back(part);
+				part = fresh(++cluster);
 			}
+
+			index = clusters[cluster][i - offsets[cluster]];
+
+			member.summary = ClusterSummary{ 1, columns.values[index], 0, columns.values[index],
+				Position{ columns.x[index], columns.y[index], columns.z[index] },
+				Position{ columns.x[index], columns.y[index], columns.z[index] }, {}, nullptr };
+			member.weighted[0] = (long long)columns.values[index] * columns.x[index];
+			member.weighted[1] = (long long)columns.values[index] * columns.y[index];
+			member.weighted[2] = (long long)columns.values[index] * columns.z[index];
+			member.peak = index;
+
+			join(part, member);
 		}
-		else {
-			cout << "No clusters of size " << dist << " were found." << endl;
+
+		if (part.summary.count != 0) {
+			partials[chunk].push_back(part);
 		}
+	});
+
+	totals.resize(clusters.size(), fresh(0));
 
+	for (const vector<Partial>& chunk : partials) {
+		for (const Partial& part : chunk) {
+			join(totals[part.cluster], part);
+		}
 	}
-}
 
-//go through the nodes of the graph and determine is there are adjacent
-//nodes that satisfy the dist constraint. 
-vector<set<Node*>> RadiationGraph::get_communities_of_size(const int dist) {
-	vector<set<Node*>> community;
-	set<Node*>* cluster;
+	for (Partial& total : totals) {
+		ClusterSummary& summary = total.summary;
+		const int corners[3] = { summary.low.x + summary.high.x, summary.low.y + summary.high.y,
+			summary.low.z + summary.high.z };
 
-	//get each set which consists of the evaluated cluster and dealloc memory
-	for each(pair<string, Node*> curr in knowledge_base) {
-		cluster = depth_first_analysis(curr.second, dist);
+		summary.mean = (double)summary.sum / summary.count;
+		summary.peak = columns.nodes[total.peak]->location_info;
 
-		//exclude clusters of self only
-		if (cluster->size() > 1) {
-			community.push_back(*cluster);
+		//readings that are all zero carry no weight, so fall back on the
+		//middle of the box
+		for (int axis = 0; axis < 3; axis++) {
+			summary.centroid[axis] = summary.sum != 0 ? (double)total.weighted[axis] / summary.sum :
+				corners[axis] / 2.0;
 		}
-		delete cluster;
+		summaries.push_back(summary);
 	}
 
-	return community;
+	return summaries;
 }
 
-//Starting at some node in the graph. Go outwards in
-//all directions and see if the adjacent node is within the distance
-//constraint specified in the parameter
-set<Node*>* RadiationGraph::depth_first_analysis(Node* curr, const int dist) {
+//one line per cluster in place of every member
+void RadiationGraph::print_cluster_summary(const int dist) {
+	vector<ClusterSummary> summaries;
+	int counter = 1;
 
-	set<Node*>* community = new set<Node*>;
+	if (dist <= 0) {
+		cout << "Invalid distance " << dist << endl;
+		return;
+	}
 
-	community->insert(curr);
+	auto start = chrono::high_resolution_clock::now();
+	summaries = summarize_clusters(dist);
+	double elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
 
-	//null check even though items from knowledge base should never be null (precaution)
-	if (curr != nullptr) {
-		depth_first_analysis_helper(community, curr, dist);
+	for (const ClusterSummary& summary : summaries) {
+		cout << "Cluster " << counter++ << ": " << summary.count << " readings, sum " << summary.sum <<
+			", mean " << summary.mean << ", peak " << summary.max << " at " << summary.peak->coordinate <<
+			", box (" << summary.low.x << ", " << summary.low.y << ", " << summary.low.z << ") to (" <<
+			summary.high.x << ", " << summary.high.y << ", " << summary.high.z << "), centroid (" <<
+			summary.centroid[0] << ", " << summary.centroid[1] << ", " << summary.centroid[2] << ")" << endl;
 	}
-	return community;
 
+	if (summaries.empty()) {
+		cout << "No clusters of size " << dist << " were found." << endl;
+	}
+	cout << summaries.size() << " clusters summarized in " << elapsed << " ms\n" << endl;
 }
 
-// see depth_first_anlysis
-void RadiationGraph::depth_first_analysis_helper(set<Node*>* community,
-	Node* curr, const int dist) {
+//prints how many clusters exist for every distance from 1 up to max_dist and,
+//if list_dist is positive, the members of the clusters at that distance.
+//Both come from the single linkage tree which is only rebuilt after the
+//graph changes
+void RadiationGraph::print_cluster_sweep(const int max_dist, const int list_dist) {
+	vector<vector<uint32_t>> clusters;
+	vector<int> curve;
+	int counter = 1;
 
-	int directional_dist = 0, current_dist = 0;
+	if (max_dist <= 0) {
+		cout << "Invalid distance " << max_dist << endl;
+		return;
+	}
 
-	//ascend upwards as far as possible first.
-	if (curr->ascend != nullptr && curr->ascend->val != VACANT) {
-		directional_dist = get_directional_dist(curr->ascend, ASCEND);
-		current_dist = get_directional_dist(curr, ASCEND);
+	auto start = chrono::high_resolution_clock::now();
+	refresh_dendrogram();
+	cout << "Single linkage tree over " << dendrogram.edge_count() << " edges ready in " <<
+		chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count()
+		<< " ms" << endl;
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
-		}
+	curve = dendrogram.cluster_curve(max_dist);
 
-		if (directional_dist != VACANT && (curr->ascend->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->ascend);
-			depth_first_analysis_helper(community, curr->ascend, dist);
-		}
+	for (int dist = 1; dist <= max_dist; dist++) {
+		cout << "Distance " << dist << ": " << curve[dist] << " clusters" << endl;
 	}
 
-	//descend as far as possible
-	if (curr->descend != nullptr && curr->descend->val != VACANT) {
-		directional_dist = get_directional_dist(curr->descend, DESCEND);
-		current_dist = get_directional_dist(curr, DESCEND);
+	if (list_dist > 0) {
+		clusters = dendrogram.clusters_at(list_dist);
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
+		for (vector<uint32_t>& cluster : clusters) {
+			cout << "Cluster " << counter << endl;
+
+			for (uint32_t member : cluster) {
+				cout << to_string(columns.nodes[member]);
+			}
+			cout << endl;
+			counter++;
 		}
 
-		if (directional_dist != VACANT && (curr->descend->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->descend);
-			depth_first_analysis_helper(community, curr->descend, dist);
+		if (clusters.empty()) {
+			cout << "No clusters of size " << list_dist << " were found." << endl;
 		}
 	}
+}
 
-	//Move northward as far as possible
-	if (curr->north != nullptr && curr->north->val != VACANT) {
-		directional_dist = get_directional_dist(curr->north, NORTH);
-		current_dist = get_directional_dist(curr, NORTH);
+//prints the density based clusters of every reading with a value of at least
+//min_value (VACANT for all readings). A reading needs min_pts readings
+//within eps of it, itself included, to grow a cluster
+void RadiationGraph::print_density_clusters(const double eps, const int min_pts,
+	const int min_value) {
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
-		}
+	DensityClustering density;
+	int counter = 1;
+	double elapsed;
 
-		if (directional_dist != VACANT && (curr->north->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->north);
-			depth_first_analysis_helper(community, curr->north, dist);
-		}
+	refresh_columns();
+
+	auto start = chrono::high_resolution_clock::now();
+	if (!density.run(columns, eps, min_pts, min_value)) {
+		cout << "Invalid radius " << eps << " or minimum of " << min_pts << endl;
+		return;
 	}
+	elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
 
-	//move as far south as possible
-	if (curr->south != nullptr && curr->south->val != VACANT) {
-		directional_dist = get_directional_dist(curr->south, SOUTH);
-		current_dist = get_directional_dist(curr, SOUTH);
+	for (const vector<uint32_t>& cluster : density.get_clusters()) {
+		cout << "Cluster " << counter << endl;
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
+		for (uint32_t member : cluster) {
+			cout << to_string(columns.nodes[member]);
 		}
+		cout << endl;
+		counter++;
+	}
 
-		if (directional_dist != VACANT && (curr->south->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->south);
-			depth_first_analysis_helper(community, curr->south, dist);
-		}
+	cout << density.get_clusters().size() << " clusters with " << density.get_core() <<
+		" core readings and " << density.get_noise() << " noise readings" << endl;
+	cout << "Scanned " << columns.size() << " nodes in " << elapsed * 1000 << " ms using " <<
+		Utility::thread_count() << " threads";
+	if (elapsed > 0) {
+		cout << " (" << columns.size() / elapsed << " nodes/s)";
+	}
+	cout << "\n" << endl;
+}
+
+//rebuilds the single linkage tree if the graph changed since it was built
+void RadiationGraph::refresh_dendrogram() {
+	refresh_columns();
+
+	if (!dendrogram.is_built() || dendrogram_version != mutations) {
+		dendrogram.build(columns);
+		dendrogram_version = mutations;
 	}
+}
 
-	//move as far east as possible
-	if (curr->east != nullptr && curr->east->val != VACANT) {
-		directional_dist = get_directional_dist(curr->east, EAST);
-		current_dist = get_directional_dist(curr, EAST);
+//the clusters at dist as sets of nodes, in the order cluster_members
+//lists them
+vector<set<Node*>> RadiationGraph::get_communities_of_size(const int dist, const RoaringBitmap* mask) {
+	vector<set<Node*>> community;
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
+	for (const vector<uint32_t>& members : cluster_members(dist, mask)) {
+		set<Node*> cluster;
+
+		for (uint32_t index : members) {
+			cluster.insert(columns.nodes[index]);
 		}
+		community.push_back(cluster);
+	}
+
+	return community;
+}
+
+//the clusters at dist as column indices. Two readings are in the same
+//cluster when a chain of links no longer than dist joins them, whichever
+//of the two ends the link is stored on. Vacant nodes join nothing and with
+//a mask only the readings in it do. The links are gathered in parallel and
+//joined into components afterwards, each component keeping its lowest index
+//as its root, so every cluster is listed once in order of its first member
+vector<vector<uint32_t>> RadiationGraph::cluster_members(const int dist, const RoaringBitmap* mask) {
+	const char order[] = { ASCEND, DESCEND, NORTH, SOUTH, EAST, WEST };
+	vector<vector<pair<uint32_t, uint32_t>>> slices(Utility::thread_count());
+	vector<vector<uint32_t>> clusters;
+	vector<uint32_t> seeds, parent, cluster;
+
+	refresh_columns();
+
+	if (dist <= 0) {
+		return clusters;
+	}
 
-		if (directional_dist != VACANT && (curr->east->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->east);
-			depth_first_analysis_helper(community, curr->east, dist);
+	const uint32_t reach = (uint32_t)dist;
+
+	auto joins = [&](uint32_t index) {
+		return columns.values[index] != VACANT && (mask == nullptr || mask->contains(index));
+	};
+
+	auto root = [&](uint32_t curr) {
+		while (parent[curr] != curr) {
+			parent[curr] = parent[parent[curr]];
+			curr = parent[curr];
 		}
+		return curr;
+	};
+
+	if (mask == nullptr) {
+		seeds.resize(columns.size());
+		iota(seeds.begin(), seeds.end(), 0);
 	}
+	else {
+		seeds = mask->members();
+	}
+
+	Utility::parallel_for(seeds.size(), [&](size_t chunk, size_t begin, size_t end) {
+		uint32_t curr, next;
+
+		for (size_t i = begin; i < end; i++) {
+			curr = seeds[i];
 
-	//go as far westward as possible
-	if (curr->west != nullptr && curr->west->val != VACANT) {
-		directional_dist = get_directional_dist(curr->west, WEST);
-		current_dist = get_directional_dist(curr, WEST);
+			if (!joins(curr)) {
+				continue;
+			}
+
+			for (char direct : order) {
+				next = columns.links(direct)[curr];
 
-		//current should never be -1. set to zero if case arises
-		if (current_dist == VACANT) {
-			current_dist = 0;
+				if (next != NO_NEIGHBOR && next != curr && joins(next) &&
+					columns.distance(curr, next) <= reach) {
+					slices[chunk].push_back(make_pair(curr, next));
+				}
+			}
 		}
+	});
 
-		if (directional_dist != VACANT && (curr->west->location_info->directionals
-			.at(directional_dist) - curr->location_info->directionals.at(current_dist)) <= dist) {
-			community->insert(curr->west);
-			depth_first_analysis_helper(community, curr->west, dist);
+	parent.resize(columns.size());
+	iota(parent.begin(), parent.end(), 0);
+
+	for (const vector<pair<uint32_t, uint32_t>>& slice : slices) {
+		for (const pair<uint32_t, uint32_t>& link : slice) {
+			uint32_t from = root(link.first), to = root(link.second);
+
+			if (from < to) {
+				parent[to] = from;
+			}
+			else if (to < from) {
+				parent[from] = to;
+			}
 		}
 	}
-}
 
+	//a root is the lowest index of its component, so going through the
+	//seeds in order meets every root before the rest of its members
+	cluster.assign(columns.size(), NO_NEIGHBOR);
 
-//given one of the predefined directionals, attempt to find the distance
-//associated with it.  If not found, then return error code -1 (vacant)
-int RadiationGraph::get_directional_dist(Node* node, const char direct) {
-	Location* loc = node->location_info;
+	for (uint32_t index : seeds) {
+		uint32_t top;
 
-	for (int i = 0; i < loc->directionals.size(); i++) {
-		if (loc->directionals.at(i) == direct) {
-			return i;
+		if (!joins(index)) {
+			continue;
 		}
+
+		top = root(index);
+
+		if (cluster[top] == NO_NEIGHBOR) {
+			cluster[top] = uint32_t(clusters.size());
+			clusters.push_back(vector<uint32_t>());
+		}
+		clusters[cluster[top]].push_back(index);
 	}
 
-	return VACANT;
+	//exclude clusters of self only
+	clusters.erase(remove_if(clusters.begin(), clusters.end(),
+		[](const vector<uint32_t>& members) { return members.size() < 2; }), clusters.end());
+
+	return clusters;
+}
+
+//the column store brought up to date with the graph
+const NodeColumns& RadiationGraph::get_columns() {
+	refresh_columns();
+	return columns;
 }
 
 //to string, what is this.. java?
@@ -375,8 +619,6 @@ void RadiationGraph::display(int predefined_choice) {
 				}
 
 			}
-
-			cout.flush();
 		}
 	}
 	else {
@@ -389,7 +631,10 @@ void RadiationGraph::display(int predefined_choice) {
 const std::string RadiationGraph::printOptions() {
 
 	return "Enter the number associated with your selection:\nAdd Item(1)\n"
-		"Delete(2)\nSize(3)\nDisplay(4)\nClusters(5)\nHistogram(6)\nExit(7)\n";
+		"Delete(2)\nSize(3)\nDisplay(4)\nClusters(5)\nHistogram(6)\nExit(7)\nDefragment(8)\nCluster Sweep(9)\n"
+		"Density Clusters(10)\nRegion Totals(11)\nRegion Summary(12)\nTrends(13)\nChannels(14)\nExport(15)\n"
+		"Find(16)\nSimulate(17)\nHottest(18)\nValue Range(19)\nAlerts(20)\nSnapshot(21)\nApproximate Stats(22)\n"
+		"Cluster Summary(23)\nDose Along Path(24)\nIsosurface(25)\n";
 }
 
 //given a dyanamically allocated node, updates its information to
@@ -447,17 +692,24 @@ Found* RadiationGraph::in_graph(string *command) {
 void RadiationGraph::add(string *command) {
 
 	Node* new_node = new Node;
-	Node* match;
-	struct Location* parsed_location = new Location;
 
-	new_node->location_info = parsed_location;
+	new_node->location_info = new Location;
 	parseCommand(command, new_node);
+	insert(new_node, Utility::permutations(new_node->location_info->coordinate));
+}
+
+//places a parsed node into the graph given every spelling of its
+//coordinate. The node is freed if its position is already in the graph
+void RadiationGraph::insert(Node* new_node, const set<string>& permutations) {
+
+	Node* match;
+	struct Location* parsed_location = new_node->location_info;
 
 	//permutation swap and check if node equivalent position
-	if ((match = isMatch(parsed_location)) != nullptr) {
+	if ((match = isMatch(permutations)) != nullptr) {
 
 		//match found so update its value and free memory for unnecessary new node
-		match->val = new_node->val;
+		set_reading(match, new_node);
 		delete new_node->location_info;
 		delete new_node;
 		return;
@@ -465,15 +717,19 @@ void RadiationGraph::add(string *command) {
 
 	//update of the centroid value
 	if (new_node->location_info->directionals.at(0) == CENTROID) {
-		centroid->val = new_node->val;
+		set_reading(centroid, new_node);
 		knowledge_base.erase(parsed_location->coordinate);
 		delete new_node->location_info;
 		delete new_node;
 	}
-	else {
+	else if (!resume_from_finger(new_node)) {
 		//adding the node to the 3D graph
 		addRecursive(centroid, nullptr, new_node, 0);
 	}
+
+	if (versioning) {
+		settle_versions();
+	}
 }
 
 //removes a node from the graph and deallocs all memory associated
@@ -487,7 +743,8 @@ void RadiationGraph::remove(string * command) {
 	//centroid removal
 	if (command->at(0) == CENTROID) {
 		to_remove = knowledge_base.find("CENTROID")->second;
-		to_remove->val = VACANT;
+		set_value(to_remove, VACANT);
+		invalidate_fingers();
 	} // we need to remove node and update all references
 	else {
 		to_remove = new Node;
@@ -500,7 +757,8 @@ void RadiationGraph::remove(string * command) {
 			== knowledge_base.end()) {
 		}// the node exists, mark as vacant for possible cleanup
 		else {
-			node_iterator->second->val = VACANT;
+			set_value(node_iterator->second, VACANT);
+			invalidate_fingers();
 		}
 
 		//delete the temp node
@@ -513,13 +771,10 @@ void RadiationGraph::remove(string * command) {
 //is equivalent to one that is already in the graph
 //ex. N2E2 == E2N2.  If there is no perm found, 
 //then nullptr is returned
-Node* RadiationGraph::isMatch(Location* loc) {
+Node* RadiationGraph::isMatch(const set<string>& permutations) {
 
-	int counter = 0;
 	map<string, Node*>::iterator foundEntry;
 
-	set<string> permutations = Utility::permutations(loc->coordinate);
-
 	//find match
 	for each(string perm in permutations) {
 		if ((foundEntry = knowledge_base.find(perm)) != knowledge_base.end()) {
@@ -529,6 +784,760 @@ Node* RadiationGraph::isMatch(Location* loc) {
 	return nullptr;
 }
 
+//places a node in the knowledge base under the given key and indexes
+//its resolved position along the z-order curve
+void RadiationGraph::register_node(const string& key, Node* node) {
+	Position pos;
+
+	if (knowledge_base.insert(pair<string, Node*>(key, node)).second) {
+		channel_count = max(channel_count, node->location_info->channels.size() + 1);
+		pos = Utility::resolve(node->location_info);
+		morton_index.insert(pair<uint64_t, Node*>(Utility::morton_encode(pos), node));
+		columns_dirty = true;
+		mutations++;
+		node->slot = slots++;
+
+		if (versioning) {
+			versions.push_back(version_of(node, pos));
+			fresh_nodes.push_back(node);
+		}
+
+		if (node->val != VACANT) {
+			notify_change(node, pos, VACANT, node->val);
+		}
+	}
+}
+
+//changes the value held by a node that is already in the graph and
+//keeps the column store in step with it. With a channel mix the node's
+//mix is worked out again from its channels in the columns
+void RadiationGraph::set_value(Node* node, int val) {
+	int old_val = node->val, old_column;
+
+	node->val = val;
+	mutations++;
+
+	//nodes left out of the knowledge base have no slot
+	if (versioning && node->slot != NO_NEIGHBOR) {
+		versions.edit(node->slot).value = val;
+	}
+
+	if (!columns_dirty && in_columns(node)) {
+		old_column = columns.values[node->id];
+
+		if (!columns.channels.empty()) {
+			columns.channels[0][node->id] = val;
+		}
+
+		if (channel_weights.empty()) {
+			columns.values[node->id] = val;
+		}
+		else {
+			columns.remix(node->id, channel_weights);
+		}
+
+		if (value_index.is_built()) {
+			value_index.patch(node->id, old_column, columns.values[node->id]);
+		}
+
+		if (dose_grid.is_built()) {
+			dose_grid.patch(Position{ columns.x[node->id], columns.y[node->id], columns.z[node->id] },
+				columns.values[node->id]);
+		}
+	}
+
+	notify_change(node, Utility::resolve(node->location_info), old_val, val);
+}
+
+//copies every channel of a parsed reading onto a node already in the graph.
+//The channel columns are patched in place unless the reading brings more
+//channels than they hold
+void RadiationGraph::set_reading(Node* node, Node* reading) {
+	const vector<int>& channels = reading->location_info->channels;
+
+	if (!channels.empty() || !node->location_info->channels.empty()) {
+		node->location_info->channels = channels;
+		channel_count = max(channel_count, channels.size() + 1);
+
+		if (columns_dirty || !in_columns(node) || channels.size() >= max(columns.channels.size(), size_t(1))) {
+			columns_dirty = true;
+		}
+		else {
+			for (size_t chan = 1; chan < columns.channels.size(); chan++) {
+				columns.channels[chan][node->id] = chan <= channels.size() ? channels[chan - 1] : 0;
+			}
+		}
+	}
+	set_value(node, reading->val);
+}
+
+//true if the node has a place in the column store as it stands
+bool RadiationGraph::in_columns(Node* node) {
+	return node->id < columns.size() && columns.nodes[node->id] == node;
+}
+
+//picks what histograms, distribution analysis and clustering run over. Each
+//weight multiplies one channel (the primary reading first) and the results
+//are summed. An empty list goes back to the primary reading alone
+void RadiationGraph::set_channel_mix(const vector<double>& weights) {
+	channel_weights = weights;
+	columns_dirty = true;
+	mutations++;
+}
+
+size_t RadiationGraph::get_channel_count() { return channel_count; }
+
+//brings the structures kept over the values up to date after the value
+//at a position changed, either by set_value or by a new node arriving
+void RadiationGraph::notify_change(Node* node, const Position& pos, int old_val, int new_val) {
+	uint64_t key = Utility::morton_encode(pos);
+	vector<int> values;
+
+	if (hotspots.is_built()) {
+		hotspots.update(node->location_info, key, old_val, new_val);
+	}
+
+	if (approximate.is_built()) {
+		approximate.update(node->location_info, old_val, new_val);
+	}
+
+	if (alerts.is_watching()) {
+		alerts.check(pos, node->location_info->coordinate, old_val, new_val);
+	}
+
+	//rebuilt at the next query, see RegionTable
+	region_stale = true;
+
+	if (pyramid.is_built()) {
+		for (auto range = morton_index.equal_range(key); range.first != range.second; ++range.first) {
+			if (range.first->second->val != VACANT) {
+				values.push_back(range.first->second->val);
+			}
+		}
+		pyramid.update(key, old_val, new_val, values);
+	}
+
+	if (history_enabled && new_val != VACANT) {
+		history[node->location_info->coordinate].record(chrono::duration_cast<chrono::milliseconds>
+			(chrono::system_clock::now().time_since_epoch()).count(), new_val);
+	}
+}
+
+//turns the recording of every reading per location on or off. Turning it
+//off throws the recorded history away
+void RadiationGraph::set_history(bool enabled) {
+	history_enabled = enabled;
+
+	if (!enabled) {
+		history.clear();
+	}
+}
+
+bool RadiationGraph::is_recording_history() { return history_enabled; }
+
+//writes the whole graph to a file in one of the Exporter formats and
+//reports how long it took
+void RadiationGraph::export_graph(const string& path, const int format, const bool edges) {
+	refresh_columns();
+
+	auto start = chrono::high_resolution_clock::now();
+
+	if (!Exporter::write(columns, path, format, edges)) {
+		cerr << "Error: Could not write " << path << endl;
+		return;
+	}
+
+	double elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	cout << "Exported " << columns.size() << " nodes to " << path << " in " << elapsed << " ms (" <<
+		(elapsed > 0 ? columns.size() / elapsed * 1000 : 0) << " nodes/s)" << endl;
+}
+
+//writes the surface where the readings cross threshold as a triangle mesh
+//in binary PLY or OBJ
+void RadiationGraph::export_isosurface(const double threshold, const string& path, const int format) {
+	IsoSurface surface;
+	double extracted, written;
+
+	refresh_dose_grid();
+
+	auto start = chrono::high_resolution_clock::now();
+	surface.extract(columns, dose_grid, threshold);
+	extracted = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	start = chrono::high_resolution_clock::now();
+
+	if (!surface.write(path, format)) {
+		cerr << "Error: Could not write " << path << endl;
+		return;
+	}
+	written = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	cout << "Surface at " << threshold << " of " << surface.vertex_count() << " vertices and " <<
+		surface.triangle_count() << " triangles extracted in " << extracted << " ms and written to " <<
+		path << " in " << written << " ms" << endl;
+}
+
+//steps the diffusion and decay simulation over every node, empty ones
+//starting at zero, and reports the total dose before and after. If keep is
+//set the result is rounded back into the graph, where empty nodes that
+//received under half a unit stay empty
+void RadiationGraph::simulate(const SimulationSettings& settings, const bool keep) {
+	Simulation simulation;
+	vector<int> start;
+	double before = 0, after = 0, elapsed;
+	int rounded;
+
+	refresh_columns();
+
+	for (Node* node : columns.nodes) {
+		start.push_back(node->val);
+		before += max(node->val, 0);
+	}
+
+	if (!simulation.build(columns, start, settings)) {
+		cout << "Invalid settings, the steps must not be negative, the boundary must be 0, 1 or 2 " <<
+			"and six times the diffusion plus the decay must be at most 1" << endl;
+		return;
+	}
+
+	elapsed = simulation.run();
+	const vector<float>& result = simulation.get_values();
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		after += result[i];
+	}
+
+	cout << "Ran " << settings.steps << " steps over " << columns.size() << " nodes in " << elapsed <<
+		" ms (" << (elapsed > 0 ? simulation.get_updates() / elapsed / 1000 : 0) <<
+		" million cell updates/s)" << endl;
+	cout << "Total dose went from " << before << " to " << after << endl;
+
+	if (!keep) {
+		return;
+	}
+
+	//the node list is copied since set_value can mark the columns stale
+	vector<Node*> nodes = columns.nodes;
+
+	for (size_t i = 0; i < nodes.size(); i++) {
+		rounded = (int)(result[i] + 0.5f);
+
+		if (nodes[i]->val == VACANT && rounded == 0) {
+			continue;
+		}
+		if (rounded != nodes[i]->val) {
+			set_value(nodes[i], rounded);
+		}
+	}
+}
+
+//prints every location whose readings over the last hour average more than
+//the threshold. The histories are split between the workers and only the
+//matches are gathered up afterwards
+void RadiationGraph::print_trends(const double threshold) {
+	vector<pair<const string, ReadingHistory>*> locations;
+	vector<vector<pair<const string, ReadingHistory>*>> matches(Utility::thread_count());
+	long long now = chrono::duration_cast<chrono::milliseconds>
+		(chrono::system_clock::now().time_since_epoch()).count();
+	double mean;
+	int most;
+
+	for (auto &entry : history) {
+		locations.push_back(&entry);
+	}
+
+	Utility::parallel_for(locations.size(), [&](size_t chunk, size_t begin, size_t end) {
+		double window_mean;
+		int window_max;
+
+		for (size_t i = begin; i < end; i++) {
+			locations[i]->second.window(now, &window_mean, &window_max);
+
+			if (window_mean > threshold) {
+				matches[chunk].push_back(locations[i]);
+			}
+		}
+	});
+
+	for (auto &chunk : matches) {
+		for (auto location : chunk) {
+			location->second.window(now, &mean, &most);
+
+			cout << "Coordinate " << location->first << " averaged " << mean << " over the last hour" <<
+				" peaking at " << most << " (decayed average " << location->second.decayed_mean() <<
+				", " << location->second.size() << " readings held)" << endl;
+		}
+	}
+	cout << endl;
+}
+
+//prints the summary of every occupied cell of a pyramid level that overlaps
+//the box. Cells at level n are 2^n on a side. The pyramid is built the
+//first time it is asked for and kept up to date from then on
+void RadiationGraph::print_pyramid(const int level, Position low, Position high) {
+	vector<PyramidCell> cells;
+	Position corner;
+
+	if (level < 0 || level >= PYRAMID_LEVELS) {
+		cout << "Invalid level " << level << ", levels range from 0 to " << PYRAMID_LEVELS - 1 << endl;
+		return;
+	}
+
+	if (!pyramid.is_built()) {
+		refresh_columns();
+
+		auto start = chrono::high_resolution_clock::now();
+		pyramid.build(columns);
+		cout << "Built " << PYRAMID_LEVELS << " pyramid levels in " <<
+			chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count()
+			<< " ms" << endl;
+	}
+
+	cells = pyramid.cells(level, low, high);
+
+	for (PyramidCell& cell : cells) {
+		corner = pyramid.cell_corner(level, cell.key);
+
+		cout << "Cell at " << corner.x << "," << corner.y << "," << corner.z << " holds " <<
+			cell.count << " readings with a mean of " << double(cell.sum) / cell.count <<
+			" and a max of " << cell.max << endl;
+	}
+
+	if (cells.empty()) {
+		cout << "No readings within the region" << endl;
+	}
+	cout << endl;
+}
+
+//builds the summed area table if it has never been built or a value
+//changed since. Returns false if the readings span too large a box
+bool RadiationGraph::refresh_region_table() {
+	if (!region_table.is_built() || region_stale) {
+		refresh_columns();
+		region_stale = !region_table.build(columns);
+	}
+	return !region_stale;
+}
+
+//count, sum and sum of squares of every reading inside of the box
+//between the two corners. The table is built the first time it is
+//needed and rebuilt by the first query after any change
+RegionTotals RadiationGraph::region_totals(Position low, Position high) {
+	RegionTotals empty = { 0, 0, 0 };
+
+	if (!refresh_region_table()) {
+		cout << "The readings span too many cells for a region table" << endl;
+		return empty;
+	}
+	return region_table.query(low, high);
+}
+
+//answers a batch of boxes in parallel
+vector<RegionTotals> RadiationGraph::region_totals(const vector<pair<Position, Position>>& boxes) {
+	if (!refresh_region_table()) {
+		cout << "The readings span too many cells for a region table" << endl;
+		return vector<RegionTotals>(boxes.size(), RegionTotals{ 0, 0, 0 });
+	}
+	return region_table.query_batch(boxes);
+}
+
+//the k hottest readings in the graph, hottest first. The index is built
+//the first time it is needed and kept up to date from then on
+vector<Hotspot> RadiationGraph::top_k(size_t k) {
+	refresh_hotspots();
+	return hotspots.top(k);
+}
+
+//the k hottest readings inside of the box between the two corners. When
+//the hottest readings mostly lie elsewhere the index gives up and the
+//readings in the box are ranked directly instead
+vector<Hotspot> RadiationGraph::top_k(size_t k, Position low, Position high) {
+	vector<Hotspot> found;
+	vector<Node*> inside;
+
+	refresh_hotspots();
+
+	if (hotspots.top_within(k, low, high, found)) {
+		return found;
+	}
+
+	inside = nodes_in_box(low, high);
+	found.clear();
+
+	for (Node* node : inside) {
+		if (node->val != VACANT) {
+			found.push_back(Hotspot{ node->val,
+				Utility::morton_encode(Utility::resolve(node->location_info)), node->location_info });
+		}
+	}
+
+	if (found.size() > k) {
+		partial_sort(found.begin(), found.begin() + k, found.end(), HotspotIndex::hotter);
+		found.resize(k);
+	}
+	else {
+		sort(found.begin(), found.end(), HotspotIndex::hotter);
+	}
+	return found;
+}
+
+void RadiationGraph::refresh_hotspots() {
+	if (!hotspots.is_built()) {
+		refresh_columns();
+		hotspots.build(columns);
+	}
+}
+
+//column indices of every reading from low to high inclusive. The bitmaps
+//are built the first time they are needed after the columns were rebuilt
+//and patched as values change, so a query costs about as much as the
+//readings it finds
+RoaringBitmap RadiationGraph::readings_between(const int low, const int high) {
+	refresh_value_index();
+	return value_index.range(low, high, columns);
+}
+
+void RadiationGraph::refresh_value_index() {
+	refresh_columns();
+
+	if (!value_index.is_built()) {
+		value_index.build(columns);
+	}
+}
+
+//lists every reading from low to high
+void RadiationGraph::print_readings_between(const int low, const int high) {
+	auto start = chrono::high_resolution_clock::now();
+	RoaringBitmap found = readings_between(low, high);
+	auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start);
+
+	for (uint32_t index : found.members()) {
+		cout << "Coordinate " << columns.nodes[index]->location_info->coordinate << " with a value of " <<
+			columns.values[index] << endl;
+	}
+
+	cout << found.cardinality() << " readings from " << low << " to " << high << " found in " <<
+		elapsed.count() << " us (index holds " << value_index.bytes() << " bytes)\n" << endl;
+}
+
+//the dose taken along the polyline through the given points. The cells
+//are laid out the first time they are needed after the columns were
+//rebuilt and patched as values change
+PathDose RadiationGraph::dose_along_path(const vector<PathPoint>& path, const DoseSettings& settings) {
+	refresh_dose_grid();
+	return dose_grid.trace(path, settings);
+}
+
+//the dose along each of many paths, PATH_CHUNK paths to a task
+vector<PathDose> RadiationGraph::dose_along_paths(const vector<vector<PathPoint>>& paths,
+	const DoseSettings& settings) {
+
+	vector<PathDose> doses(paths.size());
+
+	refresh_dose_grid();
+
+	ThreadPool::shared().run((paths.size() + PATH_CHUNK - 1) / PATH_CHUNK, [&](size_t chunk) {
+		size_t end = min(paths.size(), (chunk + 1) * PATH_CHUNK);
+
+		for (size_t i = chunk * PATH_CHUNK; i < end; i++) {
+			doses[i] = dose_grid.trace(paths[i], settings);
+		}
+	});
+
+	return doses;
+}
+
+void RadiationGraph::refresh_dose_grid() {
+	refresh_columns();
+
+	if (!dose_grid.is_built()) {
+		dose_grid.build(columns);
+	}
+}
+
+void RadiationGraph::print_dose_along_path(const vector<PathPoint>& path, const DoseSettings& settings) {
+	auto start = chrono::high_resolution_clock::now();
+	PathDose dose = dose_along_path(path, settings);
+	auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start);
+
+	if (!dose.valid) {
+		cout << "Every coordinate of the path has to be finite and within " << MAX_PATH_COORDINATE <<
+			" of the origin\n" << endl;
+		return;
+	}
+
+	cout << "Dose of " << dose.dose << " over a length of " << dose.length << " through " << dose.cells <<
+		" cells, " << dose.missing << " without a reading" << endl;
+
+	if (!dose.complete) {
+		cout << "The path was given up on at a cell without a reading" << endl;
+	}
+	cout << "Found in " << elapsed.count() << " us\n" << endl;
+}
+
+//times walking count random paths of the given number of points, each
+//point anywhere in the box the readings cover, one path at a time and
+//then spread over the pool
+void RadiationGraph::benchmark_paths(const int count, const int points, const DoseSettings& settings) {
+	vector<vector<PathPoint>> paths(max(count, 0));
+	vector<PathDose> doses;
+	Position low, high;
+	mt19937 random(count);
+	unsigned long long cells = 0;
+	double single, pooled;
+
+	refresh_dose_grid();
+	dose_grid.bounds(low, high);
+
+	uniform_real_distribution<double> along_x(low.x - 0.5, high.x + 0.5), along_y(low.y - 0.5, high.y + 0.5),
+		along_z(low.z - 0.5, high.z + 0.5);
+
+	for (vector<PathPoint>& path : paths) {
+		for (int i = 0; i < points; i++) {
+			path.push_back(PathPoint{ along_x(random), along_y(random), along_z(random) });
+		}
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+	for (const vector<PathPoint>& path : paths) {
+		cells += dose_grid.trace(path, settings).cells;
+	}
+	single = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	start = chrono::high_resolution_clock::now();
+	doses = dose_along_paths(paths, settings);
+	pooled = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	cout << paths.size() << " paths through " << cells << " cells (" << (dose_grid.is_dense() ? "dense grid of " :
+		"sorted cells in ") << dose_grid.bytes() << " bytes)" << endl;
+	cout << "One thread: " << paths.size() / max(single, 1e-9) << " paths/s, " << cells / max(single, 1e-9) <<
+		" cells/s" << endl;
+	cout << Utility::thread_count() << " threads: " << paths.size() / max(pooled, 1e-9) << " paths/s, " <<
+		cells / max(pooled, 1e-9) << " cells/s\n" << endl;
+}
+
+//calls callback, from the notifier thread, for every reading inside of the
+//box between the two corners that rises from below threshold to at least
+//threshold. Returns the id of the subscription
+size_t RadiationGraph::subscribe_alert(Position low, Position high, const int threshold,
+	const function<void(const Alert&)>& callback) {
+	return alerts.subscribe(low, high, threshold, callback);
+}
+
+bool RadiationGraph::unsubscribe_alert(size_t id) {
+	return alerts.unsubscribe(id);
+}
+
+//returns once the callbacks for every alert raised so far have run
+void RadiationGraph::wait_for_alerts() {
+	alerts.drain();
+}
+
+//a copy of the graph as it stands now that shares everything with it
+//until one or the other changes. The first snapshot lays the versioned
+//store down, from then on the store is kept up to date as the graph
+//changes and taking a snapshot is a copy of its root
+GraphSnapshot RadiationGraph::snapshot() {
+	vector<Node*> by_slot;
+	VersionedReading missing = {};
+
+	missing.value = VACANT;
+	fill(missing.links, missing.links + 6, NO_NEIGHBOR);
+
+	if (!versioning) {
+		by_slot.assign(slots, nullptr);
+
+		for (auto &entry : knowledge_base) {
+			by_slot[entry.second->slot] = entry.second;
+		}
+
+		for (Node* node : by_slot) {
+			versions.push_back(node != nullptr ? version_of(node, Utility::resolve(node->location_info)) : missing);
+		}
+		versioning = true;
+	}
+	return GraphSnapshot(versions);
+}
+
+VersionedReading RadiationGraph::version_of(Node* node, const Position& pos) {
+	Node* around[] = { node->north, node->south, node->east, node->west, node->ascend, node->descend };
+	VersionedReading reading;
+
+	reading.value = node->val;
+	reading.x = pos.x;
+	reading.y = pos.y;
+	reading.z = pos.z;
+	reading.coordinate = node->location_info->coordinate;
+
+	for (int i = 0; i < 6; i++) {
+		reading.links[i] = around[i] != nullptr ? around[i]->slot : NO_NEIGHBOR;
+	}
+	return reading;
+}
+
+//brings the links of the versioned store up to date once an insertion has
+//finished rewiring the graph. Only the new nodes and the nodes next to them
+//can have had their neighbors change. As in the column store, neighbors
+//that never made it into the knowledge base have no slot and are left out
+void RadiationGraph::settle_versions() {
+	for (Node* node : fresh_nodes) {
+		Node* affected[] = { node, node->north, node->south, node->east, node->west,
+			node->ascend, node->descend };
+
+		for (Node* curr : affected) {
+			if (curr == nullptr || curr->slot == NO_NEIGHBOR) {
+				continue;
+			}
+
+			Node* around[] = { curr->north, curr->south, curr->east, curr->west, curr->ascend, curr->descend };
+			VersionedReading& reading = versions.edit(curr->slot);
+
+			for (int i = 0; i < 6; i++) {
+				reading.links[i] = around[i] != nullptr ? around[i]->slot : NO_NEIGHBOR;
+			}
+		}
+	}
+	fresh_nodes.clear();
+}
+
+//lists the k hottest readings, within the box when restricted to it
+void RadiationGraph::print_top_k(size_t k, const bool restricted, Position low, Position high) {
+	auto start = chrono::high_resolution_clock::now();
+	vector<Hotspot> found = restricted ? top_k(k, low, high) : top_k(k);
+	auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start);
+	Position at;
+	size_t rank = 1;
+
+	for (const Hotspot& spot : found) {
+		at = Utility::morton_decode(spot.key);
+
+		cout << rank++ << ". Coordinate " << spot.location->coordinate << " at " << at.x << "," <<
+			at.y << "," << at.z << " with a value of " << spot.value << endl;
+	}
+
+	if (found.empty()) {
+		cout << "No readings" << (restricted ? " within the region" : "") << endl;
+	}
+	cout << "Found in " << elapsed.count() << " us\n" << endl;
+}
+
+//prints the totals, mean and standard deviation of the readings in a box
+void RadiationGraph::print_region_totals(Position low, Position high) {
+	RegionTotals totals = region_totals(low, high);
+	double mean, variance;
+
+	if (totals.count == 0) {
+		cout << "No readings within the region" << endl;
+		return;
+	}
+
+	mean = double(totals.sum) / totals.count;
+	variance = double(totals.sum_squares) / totals.count - mean * mean;
+
+	cout << totals.count << " readings totaling " << totals.sum << " with a mean of " << mean <<
+		" and a standard deviation of " << sqrt(max(variance, 0.0)) << "\n" << endl;
+}
+
+//rebuilds the column store if nodes were added or moved since the last build
+void RadiationGraph::refresh_columns() {
+	if (columns_dirty) {
+		columns.build(morton_index, channel_count, channel_weights);
+		columns_dirty = false;
+		value_index.clear();
+		dose_grid.clear();
+	}
+}
+
+//true if the node was allocated as part of the defragmented block
+bool RadiationGraph::is_pooled(Node* node) {
+	return node_pool != nullptr && node >= node_pool && node < node_pool + pool_size;
+}
+
+//moves every node into a single contiguous block ordered along the
+//z-order curve so that full scans and clustering walk memory in the
+//same order as space. All references are rewired to the new copies
+void RadiationGraph::defragment() {
+	Node* pool = new Node[morton_index.size()];
+	unordered_map<Node*, Node*> moved;
+	unordered_map<Node*, Node*>::iterator found;
+	size_t count = 0;
+
+	moved.reserve(morton_index.size());
+
+	//copy in z-order
+	for (auto &entry : morton_index) {
+		pool[count] = *entry.second;
+		moved[entry.second] = &pool[count];
+		entry.second = &pool[count];
+		count++;
+	}
+
+	//point the neighbors at the copies
+	for (size_t i = 0; i < count; i++) {
+		Node** links[] = { &pool[i].north, &pool[i].south, &pool[i].east,
+			&pool[i].west, &pool[i].ascend, &pool[i].descend };
+
+		for (Node** link : links) {
+			if (*link != nullptr && (found = moved.find(*link)) != moved.end()) {
+				*link = found->second;
+			}
+		}
+	}
+
+	for (auto &entry : knowledge_base) {
+		entry.second = moved[entry.second];
+	}
+	centroid = moved[centroid];
+	invalidate_fingers();
+
+	//release the old storage
+	for (auto &entry : moved) {
+		if (!is_pooled(entry.first)) {
+			delete entry.first;
+		}
+	}
+	delete[] node_pool;
+
+	node_pool = pool;
+	pool_size = count;
+	columns_dirty = true;
+	mutations++;
+}
+
+//returns every node whose resolved position falls within the box
+//spanned by the two corners. The z-order keys of the corners bound
+//every key inside of the box, so only that key range is scanned and
+//stretches of it that leave the box are skipped over with BIGMIN
+vector<Node*> RadiationGraph::nodes_in_box(Position low, Position high) {
+	vector<Node*> inside;
+	Position lower, upper;
+	uint64_t low_key, high_key, next;
+
+	lower.x = min(low.x, high.x); upper.x = max(low.x, high.x);
+	lower.y = min(low.y, high.y); upper.y = max(low.y, high.y);
+	lower.z = min(low.z, high.z); upper.z = max(low.z, high.z);
+
+	low_key = Utility::morton_encode(lower);
+	high_key = Utility::morton_encode(upper);
+
+	auto it = morton_index.lower_bound(low_key);
+
+	while (it != morton_index.end() && it->first <= high_key) {
+		if (Utility::in_box(Utility::morton_decode(it->first), lower, upper)) {
+			inside.push_back(it->second);
+			++it;
+		}
+		else if ((next = Utility::morton_bigmin(it->first, low_key, high_key)) > it->first) {
+			it = morton_index.lower_bound(next);
+		}
+		else {
+			break;
+		}
+	}
+	return inside;
+}
+
 //returns an immutable copy of the knowledge base map
 const map<string, Node*> RadiationGraph::getCurrentKnowledgeBase() const {
 	return knowledge_base;
@@ -546,6 +1555,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 	current_location == new_node->location_info->directionals.size() - 1 ?
 		last_coordinate = true : last_coordinate = false;
 
+	//every step of the last level is a valid place for the next insertion
+	//along the same prefix to resume from
+	if (last_coordinate && !finger_at.empty()) {
+		record_finger(curr, prev, new_node->location_info, current_location);
+	}
+
 	//each location in the list of directionals, move in the desired direction.
 	switch (new_node->location_info->directionals[current_location]) {
 
@@ -557,13 +1572,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->ascend == nullptr) {
 				curr->ascend = new_node;
 				new_node->descend = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->ascend->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->ascend, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -572,14 +1586,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->ascend->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->ascend = curr->ascend;
 				curr->ascend->descend = new_node;
 
 				curr->ascend = new_node;
 				new_node->descend = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//ascend is smaller so move forward
 			else {
 				return addRecursive(curr->ascend, curr, new_node, current_location);
@@ -592,14 +1606,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->descend = curr;
 				curr->ascend = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->ascend->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->ascend, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->ascend->location_info->distances.at(current_location) >
@@ -610,10 +1623,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->ascend = curr;
 				curr->descend = empty;
 
+				structure_version++;
 				prev->ascend = empty;
 				empty->descend = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -629,13 +1642,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->descend == nullptr) {
 				curr->descend = new_node;
 				new_node->ascend = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->descend->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->descend, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -644,14 +1656,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->descend->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->descend = curr->descend;
 				curr->descend->ascend = new_node;
 
 				curr->descend = new_node;
 				new_node->ascend = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//descend is smaller so move forward
 			else {
 				return addRecursive(curr->descend, curr, new_node, current_location);
@@ -664,14 +1676,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->ascend = curr;
 				curr->descend = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->descend->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->descend, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->descend->location_info->distances.at(current_location) >
@@ -682,10 +1693,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->descend = curr;
 				curr->ascend = empty;
 
+				structure_version++;
 				prev->descend = empty;
 				empty->ascend = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -702,13 +1713,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->north == nullptr) {
 				curr->north = new_node;
 				new_node->descend = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->north->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->north, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -717,14 +1727,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->north->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->north = curr->north;
 				curr->north->south = new_node;
 
 				curr->north = new_node;
 				new_node->south = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//north is smaller so move forward
 			else {
 				return addRecursive(curr->north, curr, new_node, current_location);
@@ -737,14 +1747,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->south = curr;
 				curr->north = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->north->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->north, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->north->location_info->distances.at(current_location) >
@@ -755,10 +1764,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->north = curr;
 				curr->south = empty;
 
+				structure_version++;
 				prev->north = empty;
 				empty->south = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -775,13 +1784,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->south == nullptr) {
 				curr->south = new_node;
 				new_node->north = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->south->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->south, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -790,14 +1798,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->south->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->south = curr->south;
 				curr->south->north = new_node;
 
 				curr->south = new_node;
 				new_node->north = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//south is smaller so move forward
 			else {
 				return addRecursive(curr->south, curr, new_node, current_location);
@@ -810,14 +1818,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->north = curr;
 				curr->south = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->south->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->south, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->south->location_info->distances.at(current_location) >
@@ -828,10 +1835,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->south = curr;
 				curr->north = empty;
 
+				structure_version++;
 				prev->south = empty;
 				empty->north = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -848,13 +1855,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->east == nullptr) {
 				curr->east = new_node;
 				new_node->west = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->east->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->east, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -863,14 +1869,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->east->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->east = curr->east;
 				curr->east->west = new_node;
 
 				curr->east = new_node;
 				new_node->west = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//east is smaller so move forward
 			else {
 				return addRecursive(curr->east, curr, new_node, current_location);
@@ -883,14 +1889,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->west = curr;
 				curr->east = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->east->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->east, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->east->location_info->distances.at(current_location) >
@@ -901,10 +1906,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->east = curr;
 				curr->west = empty;
 
+				structure_version++;
 				prev->east = empty;
 				empty->west = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -921,13 +1926,12 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			if (curr->west == nullptr) {
 				curr->west = new_node;
 				new_node->east = curr;
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}	//there is already a node here of same dist, overwrite vals
 			else if (curr->west->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
 				cout << "Overwritting node..." << endl;
-				curr->val = new_node->val;
+				set_reading(curr->west, new_node);
 
 				//clean up, new node not necessary
 				delete new_node->location_info;
@@ -936,14 +1940,14 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 			else if (curr->west->location_info->distances.at(current_location) >
 				new_node->location_info->distances.at(current_location)) {
 
+				structure_version++;
 				new_node->west = curr->west;
 				curr->west->east = new_node;
 
 				curr->west = new_node;
 				new_node->east = curr;
 
-				knowledge_base.insert(pair<string, Node*>
-					(new_node->location_info->coordinate, new_node));
+				register_node(new_node->location_info->coordinate, new_node);
 			}//west is smaller so move forward
 			else {
 				return addRecursive(curr->west, curr, new_node, current_location);
@@ -956,14 +1960,13 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				updateLocation(empty, new_node->location_info, current_location);
 				empty->east = curr;
 				curr->west = empty;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, curr, new_node, ++current_location);
 			}//found location, iterate to next directional
 			else if (curr->west->location_info->distances.at(current_location) ==
 				new_node->location_info->distances.at(current_location)) {
-				return addRecursive(curr, prev, new_node, ++current_location);
+				return addRecursive(curr->west, curr, new_node, ++current_location);
 			}//current larger; create temporary node with empty value 
 			 //then continue moving through graph
 			else if (curr->west->location_info->distances.at(current_location) >
@@ -974,10 +1977,10 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 				empty->west = curr;
 				curr->east = empty;
 
+				structure_version++;
 				prev->west = empty;
 				empty->east = prev;
-				knowledge_base.insert(pair<string, Node*>
-					(empty->location_info->coordinate, empty));
+				register_node(empty->location_info->coordinate, empty);
 
 				return addRecursive(empty, prev, new_node, ++current_location);
 			}//move forwards in current dir, the node is smaller direction val
@@ -994,6 +1997,102 @@ void RadiationGraph::addRecursive(Node* curr, Node* prev, Node* new_node,
 	}
 }
 
+//builds the key a finger is stored under.  the key is every directional
+//and distance before the level followed by the directional of the level
+//itself (ex. A2W2N for the north portion of A2W2N5)
+string RadiationGraph::finger_key(Location* loc, int level) {
+	string key;
+
+	for (int i = 0; i < level; i++) {
+		key.push_back(loc->directionals.at(i));
+		key.append(boost::lexical_cast<string>(loc->distances.at(i)));
+	}
+	key.push_back(loc->directionals.at(level));
+
+	return key;
+}
+
+//remembers the arguments addRecursive was entered with so that the next
+//insertion along the same prefix can skip straight to them. The key was
+//worked out once for the insertion by resume_from_finger. If the current
+//node is already on the chain for this level, the walk only stays valid for
+//distances that are at least as far as the one being inserted
+void RadiationGraph::record_finger(Node* curr, Node* prev, Location* target, int level) {
+	Location* loc = curr->location_info;
+	Finger& finger = fingers[finger_at];
+	map<string, Finger>::iterator oldest;
+
+	finger.node = curr;
+	finger.prev = prev;
+	finger.level = level;
+	finger.version = structure_version;
+	finger.last_used = ++finger_clock;
+
+	//level start nodes are reached by every insertion sharing the prefix
+	if (loc->directionals.size() > (size_t)level &&
+		loc->directionals.at(level) == target->directionals.at(level)) {
+		finger.bound = target->distances.at(level);
+	}
+	else {
+		finger.bound = VACANT;
+	}
+
+	//only a handful of fingers are kept, drop the least recently touched
+	if (fingers.size() > MAX_FINGERS) {
+		oldest = fingers.begin();
+
+		for (auto it = fingers.begin(); it != fingers.end(); ++it) {
+			if (it->second.last_used < oldest->second.last_used) {
+				oldest = it;
+			}
+		}
+		fingers.erase(oldest);
+	}
+}
+
+//attempts to place the new node by starting from the finger left on the
+//last level of its coordinate by an earlier insertion along the same
+//prefix, rather than walking in from the centroid. Also works out the key
+//the insertion records its own finger under. returns false if no finger
+//was usable
+bool RadiationGraph::resume_from_finger(Node* new_node) {
+	Location* loc = new_node->location_info;
+	map<string, Finger>::iterator found;
+	int level = (int)loc->directionals.size() - 1;
+
+	finger_at.clear();
+
+	if (level < 0 || loc->distances.size() < loc->directionals.size()) {
+		return false;
+	}
+
+	finger_at = finger_key(loc, level);
+
+	if ((found = fingers.find(finger_at)) == fingers.end()) {
+		return false;
+	}
+
+	//structure was spliced or swept since the finger was taken
+	if (found->second.version != structure_version) {
+		fingers.erase(found);
+		return false;
+	}
+
+	if (loc->distances.at(level) >= found->second.bound) {
+		addRecursive(found->second.node, found->second.prev, new_node, level);
+		return true;
+	}
+
+	return false;
+}
+
+//drops every finger. must be called whenever nodes are spliced,
+//removed or cleaned up by the sweeper
+void RadiationGraph::invalidate_fingers() {
+	structure_version++;
+	fingers.clear();
+}
+
 //given a "string" of text representing the command, parses it into a list of
 //directionals and distances with the value at the tail
 void RadiationGraph::parseCommand(string *command, Node* node) {
@@ -1014,6 +2113,12 @@ void RadiationGraph::parseCommand(string *command, Node* node) {
 			//begin to parse the integer value 
 			++pos;
 			node->val = parseInt(command, &pos);
+
+			//any further channels follow the value separated by commas
+			while (pos + 1 < command->size() && command->at(pos) == ',') {
+				++pos;
+				node->location_info->channels.push_back(parseInt(command, &pos));
+			}
 		}
 		else {
 			//integer is found, store the distance
@@ -1022,6 +2127,11 @@ void RadiationGraph::parseCommand(string *command, Node* node) {
 			--pos;
 		}
 	}
+
+	//a bare coordinate with no value, as looked up by in_graph
+	if (node->location_info->coordinate.empty()) {
+		node->location_info->coordinate = *command;
+	}
 }
 
 //given the current index and the command,parse the integer
@@ -1040,20 +2150,41 @@ int RadiationGraph::parseInt(string *command, int *index) {
 //for all of the values currently in the graph, display all of the
 //information as a histogram for the user
 void RadiationGraph::display_histogram() {
-	int hist[MAX_BINS] = { 0 };
-	int total = 0, vacants = 0;
+	vector<int> counts;
+	int total, vacants, outside;
+	int* hist;
 	map<int, int> value_occurrences;
+	vector<long long> totals;
+	double elapsed;
+
+	refresh_columns();
+	auto start = chrono::high_resolution_clock::now();
 
-	//load in count of all vals
-	for each (pair<string, Node*> curr in knowledge_base) {
-		if (curr.second->val != VACANT) {
-			hist[curr.second->val]++;
+	//load in count of all vals, the bins followed by the empty nodes, the
+	//values past the last bin and the total
+	counts = parallel_reduce(vector<int>(MAX_BINS + 3, 0), [](vector<int>& bins, const NodeView& view) {
+		if (view.value != VACANT && view.value >= 0 && view.value < MAX_BINS) {
+			bins[view.value]++;
+		}
+		else if (view.value != VACANT) {
+			bins[MAX_BINS + 1]++;
 		}
 		else {
-			vacants++;
+			bins[MAX_BINS]++;
 		}
-		total++;
-	}
+		bins[MAX_BINS + 2]++;
+	}, [](vector<int>& bins, const vector<int>& chunk) {
+		for (size_t i = 0; i < bins.size(); i++) {
+			bins[i] += chunk[i];
+		}
+	});
+
+	hist = counts.data();
+	vacants = counts[MAX_BINS];
+	outside = counts[MAX_BINS + 1];
+	total = counts[MAX_BINS + 2];
+
+	elapsed = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
 
 	//print the percentages and actual count of vals
 	for (int i = 0; i < MAX_BINS; i++) {
@@ -1068,6 +2199,72 @@ void RadiationGraph::display_histogram() {
 		cout << "With " << vacants << " empty nodes which is " << (float)vacants / total << " %" << endl;
 	}
 
+	if (outside != 0) {
+		cout << "With " << outside << " values past the last bin" << endl;
+	}
+
 	cout << Utility::distribution_type(value_occurrences) << "\n" << endl;
 
-}
\ No newline at end of file
+	if (channel_count > 1) {
+		totals = columns.channel_totals();
+
+		for (size_t chan = 0; chan < totals.size(); chan++) {
+			cout << "Channel " << chan << " totals " << totals[chan] << endl;
+		}
+		cout << endl;
+	}
+
+	cout << "Column store holds " << columns.bytes_per_node() << " bytes per node (" <<
+		sizeof(Node) + sizeof(Location) << " for a Node and its Location), scanned " <<
+		total * sizeof(int) << " bytes";
+	if (elapsed > 0) {
+		cout << " at " << total * sizeof(int) / elapsed / 1e6 << " MB/s";
+	}
+	cout << "\n" << endl;
+}
+
+//the mean, percentiles and shape of the primary readings answered from a
+//sample and sketches kept up to date as readings change, so it costs the
+//same however large the graph is. They are built the first time they are
+//needed and again once enough readings have been removed or overwritten
+//that the sketches have grown too loose
+void RadiationGraph::print_approximate_stats() {
+	const double fractions[] = { 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 };
+	double average, error;
+	int val;
+
+	if (!approximate.is_built() || approximate.is_stale()) {
+		auto build_start = chrono::high_resolution_clock::now();
+
+		refresh_columns();
+		approximate.build(columns);
+
+		cout << "Sampled and sketched " << approximate.get_readings() << " readings in " <<
+			chrono::duration<double, milli>(chrono::high_resolution_clock::now() - build_start).count() <<
+			" ms" << endl;
+	}
+
+	if (approximate.get_readings() == 0) {
+		cout << "There are no readings to summarize\n" << endl;
+		return;
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+
+	average = approximate.mean(&error);
+	cout << "Mean of " << approximate.get_readings() << " readings is " << average << " +/- " <<
+		error << " (95% confidence)" << endl;
+
+	for (double fraction : fractions) {
+		val = approximate.percentile(fraction, &error);
+		cout << "Percentile " << fraction * 100 << " is " << val << " +/- " << error * 100 <<
+			"% of readings by rank" << endl;
+	}
+
+	cout << Utility::distribution_type(approximate.sample_occurrences()) << " (from a sample of " <<
+		approximate.get_sample_size() << ")" << endl;
+
+	cout << "Answered in " << chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() -
+		start).count() << " us from " << approximate.get_sample_size() << " sampled and " <<
+		approximate.get_sketch_size() << " sketched values\n" << endl;
+}
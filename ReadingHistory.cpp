@@ -0,0 +1,203 @@
+//ReadingHistory.cpp
+#include "stdafx.h"
+#include "ReadingHistory.h"
+#include <math.h>
+#include <algorithm>
+
+//Fixed size history of the readings at one location. Positions within the
+//ring are counted from head so the encoded readings always run oldest to
+//newest, wrapping around the end of the ring
+
+//adds a reading taken at time (in ms). Readings that would not fit push
+//the oldest ones out of the ring
+void ReadingHistory::record(long long time, int val) {
+	uint8_t bytes[20];
+	size_t length;
+
+	if (count == 0) {
+		first_time = last_time = cursor_time = time;
+		first_val = last_val = cursor_val = val;
+		ema = val;
+		count = 1;
+		window_sum = val;
+		window_count = 1;
+		window_max = val;
+		return;
+	}
+
+	length = encode(time - last_time, bytes);
+	length += encode(val - last_val, bytes + length);
+
+	while (used + length > HISTORY_BYTES && count > 1) {
+		drop_oldest();
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		ring[(head + used + i) % HISTORY_BYTES] = bytes[i];
+	}
+	used += length;
+	count++;
+
+	//decay towards the new reading by how much time has passed
+	ema += (1 - exp(-double(max(time - last_time, 0LL)) / HISTORY_WINDOW_MS)) * (val - ema);
+
+	last_time = time;
+	last_val = val;
+
+	window_sum += val;
+	window_count++;
+	window_max = max(window_max, val);
+	slide_window();
+}
+
+//every reading still held, oldest first
+vector<pair<long long, int>> ReadingHistory::readings() const {
+	vector<pair<long long, int>> held;
+	long long time = first_time;
+	int val = first_val;
+	size_t pos = 0;
+
+	if (count == 0) {
+		return held;
+	}
+
+	held.push_back(make_pair(time, val));
+
+	while (pos < used) {
+		time += decode(&pos);
+		val += int(decode(&pos));
+		held.push_back(make_pair(time, val));
+	}
+	return held;
+}
+
+//mean and max of the readings taken within the hour before now. The
+//running totals are used directly unless some of the window has expired
+//since the last reading, then only the readings inside of it are decoded
+void ReadingHistory::window(long long now, double* mean, int* most) const {
+	long long time = cursor_time, sum = 0;
+	int val = cursor_val, total = 0, peak = 0;
+	size_t pos = cursor;
+
+	if (count == 0) {
+		*mean = 0;
+		*most = 0;
+		return;
+	}
+
+	if (cursor_time >= now - HISTORY_WINDOW_MS) {
+		*mean = double(window_sum) / window_count;
+		*most = window_max;
+		return;
+	}
+
+	while (true) {
+		if (time >= now - HISTORY_WINDOW_MS) {
+			sum += val;
+			peak = total == 0 ? val : max(peak, val);
+			total++;
+		}
+		if (pos >= used) {
+			break;
+		}
+		time += decode(&pos);
+		val += int(decode(&pos));
+	}
+
+	*mean = total == 0 ? 0 : double(sum) / total;
+	*most = peak;
+}
+
+double ReadingHistory::decayed_mean() const { return ema; }
+
+size_t ReadingHistory::size() const { return count; }
+
+//zigzag varint encoding of a change, returns the bytes written
+size_t ReadingHistory::encode(long long delta, uint8_t* bytes) const {
+	uint64_t zigzag = (uint64_t(delta) << 1) ^ uint64_t(delta >> 63);
+	size_t length = 0;
+
+	while (zigzag >= 0x80) {
+		bytes[length++] = uint8_t(zigzag | 0x80);
+		zigzag >>= 7;
+	}
+	bytes[length++] = uint8_t(zigzag);
+
+	return length;
+}
+
+//decodes the change starting at pos (counted from head) and moves pos past it
+long long ReadingHistory::decode(size_t* pos) const {
+	uint64_t zigzag = 0;
+	int shift = 0;
+	uint8_t byte;
+
+	do {
+		byte = ring[(head + *pos) % HISTORY_BYTES];
+		zigzag |= uint64_t(byte & 0x7f) << shift;
+		shift += 7;
+		(*pos)++;
+	} while (byte & 0x80);
+
+	return (long long)(zigzag >> 1) ^ -(long long)(zigzag & 1);
+}
+
+//folds the oldest encoded change into the first reading and frees its bytes
+void ReadingHistory::drop_oldest() {
+	size_t pos = 0;
+
+	first_time += decode(&pos);
+	first_val += int(decode(&pos));
+
+	head = (head + pos) % HISTORY_BYTES;
+	used -= pos;
+	count--;
+
+	//the window can not reach further back than what is held
+	if (cursor_index == 0) {
+		window_sum -= cursor_val;
+		window_count--;
+		cursor_time = first_time;
+		cursor_val = first_val;
+		rescan_window();
+	}
+	else {
+		cursor -= pos;
+		cursor_index--;
+	}
+}
+
+//moves the start of the window past readings older than an hour before
+//the newest one, rescanning for the max only if the max was pushed out
+void ReadingHistory::slide_window() {
+	bool lost_max = false;
+
+	while (cursor_time < last_time - HISTORY_WINDOW_MS && cursor < used) {
+		window_sum -= cursor_val;
+		window_count--;
+		lost_max |= cursor_val == window_max;
+
+		cursor_time += decode(&cursor);
+		cursor_val += int(decode(&cursor));
+		cursor_index++;
+	}
+
+	if (lost_max) {
+		rescan_window();
+	}
+}
+
+//recomputes the max of the readings from the cursor onwards
+void ReadingHistory::rescan_window() {
+	long long time = cursor_time;
+	int val = cursor_val;
+	size_t pos = cursor;
+
+	window_max = val;
+
+	while (pos < used) {
+		time += decode(&pos);
+		val += int(decode(&pos));
+		window_max = max(window_max, val);
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef READINGHISTORY_H
+#define READINGHISTORY_H
+
+#include <vector>
+#include <cstdint>
+
+#define HISTORY_BYTES 192
+#define HISTORY_WINDOW_MS 3600000LL
+
+using namespace std;
+
+//timestamped readings at one location. The oldest reading is kept as is,
+//every later one is stored as the change in time and value since the one
+//before it, zigzag varint encoded into a fixed ring of bytes. Once the ring
+//is full the oldest readings are dropped so the memory used never grows.
+//a time decayed average and the mean and max of the last hour are kept up
+//to date as readings arrive
+class ReadingHistory {
+
+public:
+	void record(long long, int);
+	vector<pair<long long, int>> readings() const;
+	void window(long long, double*, int*) const;
+	double decayed_mean() const;
+	size_t size() const;
+
+private:
+	uint8_t ring[HISTORY_BYTES];
+	size_t head = 0, used = 0, count = 0;
+	long long first_time = 0, last_time = 0;
+	int first_val = 0, last_val = 0;
+	double ema = 0;
+
+	//the oldest reading still inside of the window and its place in the ring
+	size_t cursor = 0, cursor_index = 0;
+	long long cursor_time = 0, window_sum = 0;
+	int cursor_val = 0, window_count = 0, window_max = 0;
+
+	size_t encode(long long, uint8_t*) const;
+	long long decode(size_t*) const;
+	void drop_oldest();
+	void slide_window();
+	void rescan_window();
+};
+
+#endif // !READINGHISTORY_H
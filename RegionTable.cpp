@@ -0,0 +1,170 @@
+//RegionTable.cpp
+#include "stdafx.h"
+#include "RegionTable.h"
+#include "Utility.h"
+
+//Summed area table for regional dose totals. Each axis carries one extra
+//layer of zero cells in front so that no query needs a bounds special case.
+//The table is only as large as the bounding box of the non vacant readings
+//and refuses to build past MAX_REGION_CELLS. It holds the primary readings,
+//never the channel mix. Patching a single cell would rewrite every cell
+//above it, so a change of value marks the table stale instead and the
+//whole table is rebuilt, in parallel, the next time it is queried
+
+//lays every reading into its cell and then runs a prefix sum along
+//each axis in turn. Returns false if the box is too large to hold
+bool RegionTable::build(const NodeColumns& columns) {
+	int low[3] = { INT32_MAX, INT32_MAX, INT32_MAX }, high[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+	const vector<int32_t>* axis[3] = { &columns.x, &columns.y, &columns.z };
+	long long cells = 1;
+	size_t at;
+
+	clear();
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.nodes[i]->val == VACANT) {
+			continue;
+		}
+		for (int dim = 0; dim < 3; dim++) {
+			low[dim] = min(low[dim], (*axis[dim])[i]);
+			high[dim] = max(high[dim], (*axis[dim])[i]);
+		}
+	}
+
+	for (int dim = 0; dim < 3; dim++) {
+		//nothing to hold, an empty table still answers with zeros
+		if (low[dim] > high[dim]) {
+			low[dim] = high[dim] = 0;
+		}
+		origin[dim] = low[dim];
+		extent[dim] = high[dim] - low[dim] + 2;
+		cells *= extent[dim];
+	}
+
+	if (cells > MAX_REGION_CELLS) {
+		return false;
+	}
+
+	sum.assign(size_t(cells), 0);
+	sum_squares.assign(size_t(cells), 0);
+	count.assign(size_t(cells), 0);
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.nodes[i]->val != VACANT) {
+			at = cell(columns.x[i] - origin[0] + 1, columns.y[i] - origin[1] + 1,
+				columns.z[i] - origin[2] + 1);
+			sum[at] += columns.nodes[i]->val;
+			sum_squares[at] += (long long)columns.nodes[i]->val * columns.nodes[i]->val;
+			count[at]++;
+		}
+	}
+
+	for (int dim = 0; dim < 3; dim++) {
+		accumulate(dim);
+	}
+
+	built = true;
+	return true;
+}
+
+//prefix sum along one axis. Every line along that axis is independent
+//so the lines are split up between the workers
+void RegionTable::accumulate(int dim) {
+	const int other_a = dim == 0 ? 1 : 0, other_b = dim == 2 ? 1 : 2;
+	size_t lines = size_t(extent[other_a]) * extent[other_b];
+
+	Utility::parallel_for(lines, [&](size_t, size_t begin, size_t end) {
+		int pos[3];
+		size_t prev, curr;
+
+		for (size_t line = begin; line < end; line++) {
+			pos[other_a] = int(line % extent[other_a]);
+			pos[other_b] = int(line / extent[other_a]);
+
+			for (pos[dim] = 1; pos[dim] < extent[dim]; pos[dim]++) {
+				curr = cell(pos[0], pos[1], pos[2]);
+				pos[dim]--;
+				prev = cell(pos[0], pos[1], pos[2]);
+				pos[dim]++;
+
+				sum[curr] += sum[prev];
+				sum_squares[curr] += sum_squares[prev];
+				count[curr] += count[prev];
+			}
+		}
+	});
+}
+
+//totals of every reading inside of the box between the two corners
+RegionTotals RegionTable::query(const Position& low, const Position& high) const {
+	int lower[3] = { min(low.x, high.x), min(low.y, high.y), min(low.z, high.z) };
+	int upper[3] = { max(low.x, high.x), max(low.y, high.y), max(low.z, high.z) };
+	RegionTotals totals = { 0, 0, 0 }, part;
+	int sign;
+
+	//clamp the box onto the table. lower becomes the excluded layer
+	for (int dim = 0; dim < 3; dim++) {
+		lower[dim] = max(lower[dim] - origin[dim], 0);
+		upper[dim] = min(upper[dim] - origin[dim] + 1, extent[dim] - 1);
+
+		if (!built || lower[dim] >= upper[dim]) {
+			return totals;
+		}
+	}
+
+	//inclusion exclusion over the 8 corners
+	for (int corner_id = 0; corner_id < 8; corner_id++) {
+		sign = 1;
+		int at[3];
+
+		for (int dim = 0; dim < 3; dim++) {
+			if (corner_id & (1 << dim)) {
+				at[dim] = lower[dim];
+				sign = -sign;
+			}
+			else {
+				at[dim] = upper[dim];
+			}
+		}
+
+		part = corner(at[0], at[1], at[2]);
+		totals.count += sign * part.count;
+		totals.sum += sign * part.sum;
+		totals.sum_squares += sign * part.sum_squares;
+	}
+
+	return totals;
+}
+
+//answers many boxes at once, the boxes are split between the workers
+vector<RegionTotals> RegionTable::query_batch(const vector<pair<Position, Position>>& boxes) const {
+	vector<RegionTotals> totals(boxes.size());
+
+	Utility::parallel_for(boxes.size(), [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			totals[i] = query(boxes[i].first, boxes[i].second);
+		}
+	});
+
+	return totals;
+}
+
+bool RegionTable::is_built() const { return built; }
+
+void RegionTable::clear() {
+	sum.clear();
+	sum_squares.clear();
+	count.clear();
+	built = false;
+}
+
+size_t RegionTable::cell(int x, int y, int z) const {
+	return (size_t(z) * extent[1] + y) * extent[0] + x;
+}
+
+RegionTotals RegionTable::corner(int x, int y, int z) const {
+	size_t at = cell(x, y, z);
+	RegionTotals totals = { count[at], sum[at], sum_squares[at] };
+
+	return totals;
+}
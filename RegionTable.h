@@ -0,0 +1,35 @@
+#ifndef REGIONTABLE_H
+#define REGIONTABLE_H
+
+#include "NodeColumns.h"
+
+#define MAX_REGION_CELLS (1 << 24)
+
+//totals of the readings inside of a box
+struct RegionTotals {
+	long long count, sum, sum_squares;
+};
+
+//3D summed area table over the bounding box of the resolved readings.
+//every cell holds the count, sum and sum of squares of all readings at or
+//below it along each axis so the totals of any box come from 8 cells
+class RegionTable {
+
+public:
+	bool build(const NodeColumns&);
+	RegionTotals query(const Position&, const Position&) const;
+	vector<RegionTotals> query_batch(const vector<pair<Position, Position>>&) const;
+	bool is_built() const;
+	void clear();
+
+private:
+	int origin[3] = { 0, 0, 0 }, extent[3] = { 0, 0, 0 };
+	bool built = false;
+	vector<long long> sum, sum_squares;
+	vector<uint32_t> count;
+	size_t cell(int, int, int) const;
+	void accumulate(int);
+	RegionTotals corner(int, int, int) const;
+};
+
+#endif // !REGIONTABLE_H
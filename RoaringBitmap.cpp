@@ -0,0 +1,248 @@
+//RoaringBitmap.cpp
+#include "stdafx.h"
+#include "RoaringBitmap.h"
+#include <algorithm>
+#include <bitset>
+
+//A container switches to a bitmap once its array would pass
+//ROARING_ARRAY_MAX members, the point at which the array takes as much
+//room as the bitmap, and back to an array when it drops to that again.
+//Unions work container by container so their cost follows the number of
+//members involved rather than the size of the id space
+
+//index of the container holding the given upper bits, or of where it
+//would be inserted
+size_t RoaringBitmap::locate(uint16_t high) const {
+	size_t low = 0, top = containers.size(), mid;
+
+	while (low < top) {
+		mid = (low + top) / 2;
+
+		if (containers[mid].high < high) {
+			low = mid + 1;
+		}
+		else {
+			top = mid;
+		}
+	}
+	return low;
+}
+
+//adds an id, returning false if it was already a member
+bool RoaringBitmap::add(uint32_t id) {
+	uint16_t high = (uint16_t)(id >> 16), low = (uint16_t)id;
+	size_t at = locate(high);
+	RoaringContainer* container;
+	vector<uint16_t>::iterator spot;
+
+	if (at == containers.size() || containers[at].high != high) {
+		containers.insert(containers.begin() + at, RoaringContainer{ high, 0, {}, {} });
+	}
+	container = &containers[at];
+
+	if (container->is_bitmap()) {
+		if (container->bits[low >> 6] & (1ULL << (low & 63))) {
+			return false;
+		}
+		container->bits[low >> 6] |= 1ULL << (low & 63);
+	}
+	else {
+		spot = lower_bound(container->array.begin(), container->array.end(), low);
+
+		if (spot != container->array.end() && *spot == low) {
+			return false;
+		}
+		container->array.insert(spot, low);
+
+		if (container->array.size() > ROARING_ARRAY_MAX) {
+			to_bitmap(*container);
+		}
+	}
+	container->cardinality++;
+	return true;
+}
+
+//removes an id, returning false if it was not a member
+bool RoaringBitmap::remove(uint32_t id) {
+	uint16_t high = (uint16_t)(id >> 16), low = (uint16_t)id;
+	size_t at = locate(high);
+	RoaringContainer* container;
+	vector<uint16_t>::iterator spot;
+
+	if (at == containers.size() || containers[at].high != high) {
+		return false;
+	}
+	container = &containers[at];
+
+	if (container->is_bitmap()) {
+		if (!(container->bits[low >> 6] & (1ULL << (low & 63)))) {
+			return false;
+		}
+		container->bits[low >> 6] &= ~(1ULL << (low & 63));
+	}
+	else {
+		spot = lower_bound(container->array.begin(), container->array.end(), low);
+
+		if (spot == container->array.end() || *spot != low) {
+			return false;
+		}
+		container->array.erase(spot);
+	}
+
+	if (--container->cardinality == 0) {
+		containers.erase(containers.begin() + at);
+	}
+	else if (container->is_bitmap() && container->cardinality <= ROARING_ARRAY_MAX) {
+		to_array(*container);
+	}
+	return true;
+}
+
+bool RoaringBitmap::contains(uint32_t id) const {
+	uint16_t high = (uint16_t)(id >> 16), low = (uint16_t)id;
+	size_t at = locate(high);
+	const RoaringContainer* container;
+
+	if (at == containers.size() || containers[at].high != high) {
+		return false;
+	}
+	container = &containers[at];
+
+	if (container->is_bitmap()) {
+		return (container->bits[low >> 6] & (1ULL << (low & 63))) != 0;
+	}
+	return binary_search(container->array.begin(), container->array.end(), low);
+}
+
+//unions the other bitmap into this one
+void RoaringBitmap::add_all(const RoaringBitmap& other) {
+	size_t at = 0;
+
+	for (const RoaringContainer& theirs : other.containers) {
+		while (at < containers.size() && containers[at].high < theirs.high) {
+			at++;
+		}
+
+		if (at == containers.size() || containers[at].high != theirs.high) {
+			containers.insert(containers.begin() + at, theirs);
+		}
+		else {
+			merge(containers[at], theirs);
+		}
+		at++;
+	}
+}
+
+//unions a container into one with the same upper bits
+void RoaringBitmap::merge(RoaringContainer& ours, const RoaringContainer& theirs) {
+	vector<uint16_t> joined;
+	uint32_t count = 0;
+
+	if (!ours.is_bitmap() && !theirs.is_bitmap() &&
+		ours.cardinality + theirs.cardinality <= ROARING_ARRAY_MAX) {
+
+		joined.reserve(ours.cardinality + theirs.cardinality);
+		set_union(ours.array.begin(), ours.array.end(), theirs.array.begin(), theirs.array.end(),
+			back_inserter(joined));
+		ours.array.swap(joined);
+		ours.cardinality = (uint32_t)ours.array.size();
+		return;
+	}
+
+	if (!ours.is_bitmap()) {
+		to_bitmap(ours);
+	}
+
+	if (theirs.is_bitmap()) {
+		for (size_t word = 0; word < ROARING_WORDS; word++) {
+			ours.bits[word] |= theirs.bits[word];
+		}
+	}
+	else {
+		for (uint16_t low : theirs.array) {
+			ours.bits[low >> 6] |= 1ULL << (low & 63);
+		}
+	}
+
+	for (uint64_t word : ours.bits) {
+		count += (uint32_t)bitset<64>(word).count();
+	}
+	ours.cardinality = count;
+
+	if (count <= ROARING_ARRAY_MAX) {
+		to_array(ours);
+	}
+}
+
+void RoaringBitmap::to_bitmap(RoaringContainer& container) {
+	container.bits.assign(ROARING_WORDS, 0);
+
+	for (uint16_t low : container.array) {
+		container.bits[low >> 6] |= 1ULL << (low & 63);
+	}
+	vector<uint16_t>().swap(container.array);
+}
+
+void RoaringBitmap::to_array(RoaringContainer& container) {
+	uint64_t word;
+
+	container.array.clear();
+	container.array.reserve(container.cardinality);
+
+	for (size_t i = 0; i < ROARING_WORDS; i++) {
+		for (word = container.bits[i]; word != 0; word &= word - 1) {
+			container.array.push_back((uint16_t)(i * 64 + bitset<64>((word & (~word + 1)) - 1).count()));
+		}
+	}
+	vector<uint64_t>().swap(container.bits);
+}
+
+size_t RoaringBitmap::cardinality() const {
+	size_t count = 0;
+
+	for (const RoaringContainer& container : containers) {
+		count += container.cardinality;
+	}
+	return count;
+}
+
+//every member in ascending order
+vector<uint32_t> RoaringBitmap::members() const {
+	vector<uint32_t> ids;
+	uint32_t base;
+	uint64_t word;
+
+	ids.reserve(cardinality());
+
+	for (const RoaringContainer& container : containers) {
+		base = (uint32_t)container.high << 16;
+
+		if (!container.is_bitmap()) {
+			for (uint16_t low : container.array) {
+				ids.push_back(base | low);
+			}
+			continue;
+		}
+
+		for (size_t i = 0; i < ROARING_WORDS; i++) {
+			for (word = container.bits[i]; word != 0; word &= word - 1) {
+				ids.push_back(base | (uint32_t)(i * 64 + bitset<64>((word & (~word + 1)) - 1).count()));
+			}
+		}
+	}
+	return ids;
+}
+
+//memory held by the containers
+size_t RoaringBitmap::bytes() const {
+	size_t total = containers.capacity() * sizeof(RoaringContainer);
+
+	for (const RoaringContainer& container : containers) {
+		total += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+	}
+	return total;
+}
+
+bool RoaringBitmap::empty() const { return containers.empty(); }
+
+void RoaringBitmap::clear() { containers.clear(); }
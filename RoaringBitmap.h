@@ -0,0 +1,48 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <vector>
+#include <cstdint>
+
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_WORDS 1024
+
+using namespace std;
+
+//the members of a bitmap sharing their upper 16 bits. Up to
+//ROARING_ARRAY_MAX members are kept as a sorted array of their lower 16
+//bits, past that as a plain bitmap of ROARING_WORDS words
+struct RoaringContainer {
+	uint16_t high;
+	uint32_t cardinality;
+	vector<uint16_t> array;
+	vector<uint64_t> bits;
+
+	bool is_bitmap() const { return !bits.empty(); }
+};
+
+//compressed set of 32 bit ids split into containers of 2^16 ids each, so
+//sparse stretches cost two bytes a member and dense ones an eighth of a
+//byte. Containers are kept sorted by their upper bits
+class RoaringBitmap {
+
+public:
+	bool add(uint32_t);
+	bool remove(uint32_t);
+	bool contains(uint32_t) const;
+	void add_all(const RoaringBitmap&);
+	size_t cardinality() const;
+	vector<uint32_t> members() const;
+	size_t bytes() const;
+	bool empty() const;
+	void clear();
+
+private:
+	vector<RoaringContainer> containers;
+	size_t locate(uint16_t) const;
+	static void to_bitmap(RoaringContainer&);
+	static void to_array(RoaringContainer&);
+	static void merge(RoaringContainer&, const RoaringContainer&);
+};
+
+#endif // !ROARINGBITMAP_H
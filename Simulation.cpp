@@ -0,0 +1,101 @@
+//Simulation.cpp
+#include "stdafx.h"
+#include "Simulation.h"
+#include "Utility.h"
+#include <chrono>
+
+//The update for a cell with value v and neighbors n1..n6 is
+//v + diffusion * (n1 + ... + n6 - 6v) - decay * v, which is rewritten as
+//keep * v + diffusion * (n1 + ... + n6) so the inner loop is a gather and
+//a multiply add the compiler can vectorize. Fixed cells blend back to
+//their old value through held, which is 1 for them and 0 for the rest.
+//The scheme stays stable while 6 * diffusion + decay is at most 1
+
+//sets up a run over the columns starting from the given values, one per
+//node. Returns false if the step count is negative, the boundary is not
+//one of SIM_REFLECT, SIM_ABSORB or SIM_FIXED or the rates would make the
+//stencil unstable
+bool Simulation::build(const NodeColumns& columns, const vector<int>& start,
+	const SimulationSettings& chosen) {
+
+	const vector<uint32_t>* links[6] = { &columns.north, &columns.south, &columns.east,
+		&columns.west, &columns.ascend, &columns.descend };
+
+	settings = chosen;
+	cells = columns.size();
+	updates = 0;
+
+	if (settings.steps < 0 || settings.boundary < SIM_REFLECT || settings.boundary > SIM_FIXED) {
+		return false;
+	}
+
+	if (settings.diffusion < 0 || settings.decay < 0 || 6 * settings.diffusion + settings.decay > 1) {
+		return false;
+	}
+
+	//the ghost cell at the end stays empty
+	current.assign(cells + 1, 0);
+	next.assign(cells + 1, 0);
+	held.assign(cells, 0);
+
+	for (size_t i = 0; i < cells; i++) {
+		current[i] = (float)max(start[i], 0);
+	}
+
+	for (int direction = 0; direction < 6; direction++) {
+		neighbors[direction].resize(cells);
+
+		for (size_t i = 0; i < cells; i++) {
+			uint32_t link = (*links[direction])[i];
+
+			if (link != NO_NEIGHBOR) {
+				neighbors[direction][i] = link;
+			}
+			else {
+				neighbors[direction][i] = settings.boundary == SIM_ABSORB ? (uint32_t)cells : (uint32_t)i;
+				held[i] = settings.boundary == SIM_FIXED ? 1.0f : held[i];
+			}
+		}
+	}
+
+	return true;
+}
+
+//runs every step, returning how long it took in ms
+double Simulation::run() {
+	auto start = chrono::high_resolution_clock::now();
+
+	for (int i = 0; i < settings.steps; i++) {
+		Utility::parallel_for(cells, [&](size_t, size_t begin, size_t end) {
+			step(begin, end);
+		});
+
+		current.swap(next);
+		updates += cells;
+	}
+
+	return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+//one step over a range of cells, reading current and writing next
+void Simulation::step(size_t begin, size_t end) {
+	const float keep = float(1 - 6 * settings.diffusion - settings.decay);
+	const float rate = float(settings.diffusion);
+	const float* values = current.data();
+	const uint32_t *n0 = neighbors[0].data(), *n1 = neighbors[1].data(), *n2 = neighbors[2].data(),
+		*n3 = neighbors[3].data(), *n4 = neighbors[4].data(), *n5 = neighbors[5].data();
+	const float* fixed = held.data();
+	float* out = next.data();
+	float stepped;
+
+	for (size_t i = begin; i < end; i++) {
+		stepped = keep * values[i] + rate * (values[n0[i]] + values[n1[i]] + values[n2[i]] +
+			values[n3[i]] + values[n4[i]] + values[n5[i]]);
+		out[i] = stepped + fixed[i] * (values[i] - stepped);
+	}
+}
+
+//the values after the last step, one per node followed by the ghost cell
+const vector<float>& Simulation::get_values() const { return current; }
+
+unsigned long long Simulation::get_updates() const { return updates; }
@@ -0,0 +1,46 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "NodeColumns.h"
+
+#define SIM_REFLECT 0
+#define SIM_ABSORB 1
+#define SIM_FIXED 2
+
+//what a run of the simulation does. Every step each cell gains diffusion
+//times the difference between each of its six neighbors and itself and
+//then loses decay times what it holds. The boundary decides what stands in
+//for a missing neighbor: the cell itself so nothing crosses (reflect),
+//an empty cell that drains it (absorb), or the cell is held where it is
+//(fixed)
+struct SimulationSettings {
+	int steps;
+	double diffusion, decay;
+	int boundary;
+};
+
+//explicit diffusion and decay stencil over the column store. The links
+//are resolved once up front, a missing one pointing either back at the
+//cell or at a ghost cell past the end that is always empty, so each step
+//is the same branch free loop over every cell. Values are stepped between
+//two float buffers with the cells split between the workers in z-order,
+//so every worker has a compact region of space to itself
+class Simulation {
+
+public:
+	bool build(const NodeColumns&, const vector<int>&, const SimulationSettings&);
+	double run();
+	const vector<float>& get_values() const;
+	unsigned long long get_updates() const;
+
+private:
+	SimulationSettings settings;
+	vector<uint32_t> neighbors[6];
+	vector<float> current, next, held;
+	size_t cells = 0;
+	unsigned long long updates = 0;
+
+	void step(size_t, size_t);
+};
+
+#endif // !SIMULATION_H
@@ -0,0 +1,96 @@
+//ThreadPool.cpp
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+//set on threads that are running pool tasks
+static thread_local bool in_pool = false;
+
+ThreadPool::ThreadPool(size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		workers.push_back(thread(&ThreadPool::work, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+}
+
+//one worker per hardware thread beside the caller
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool(thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() - 1 : 0);
+
+	return pool;
+}
+
+//how many threads take part in a run, the caller included
+size_t ThreadPool::size() const { return workers.size() + 1; }
+
+//runs task(0) to task(tasks - 1) across the pool
+void ThreadPool::run(size_t tasks, const function<void(size_t)>& task) {
+	if (tasks <= 1 || workers.empty() || in_pool) {
+		for (size_t i = 0; i < tasks; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	lock_guard<mutex> turn(submit);
+	{
+		lock_guard<mutex> guard(lock);
+		job = &task;
+		job_tasks = tasks;
+		next_task = 0;
+		finished = 0;
+		generation++;
+	}
+	wake.notify_all();
+
+	in_pool = true;
+	drain();
+	in_pool = false;
+
+	unique_lock<mutex> guard(lock);
+	done.wait(guard, [&]() { return finished == workers.size(); });
+	job = nullptr;
+}
+
+void ThreadPool::work() {
+	unique_lock<mutex> guard(lock);
+	unsigned long long seen = 0;
+
+	in_pool = true;
+
+	while (true) {
+		wake.wait(guard, [&]() { return stopping || generation != seen; });
+
+		if (stopping) {
+			return;
+		}
+
+		seen = generation;
+		guard.unlock();
+		drain();
+		guard.lock();
+
+		if (++finished == workers.size()) {
+			done.notify_one();
+		}
+	}
+}
+
+//takes tasks until there are none left
+void ThreadPool::drain() {
+	size_t task;
+
+	while ((task = next_task++) < job_tasks) {
+		(*job)(task);
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+//a fixed set of worker threads started once and shared by every parallel
+//pass, so a pass costs a wake up rather than creating threads. run hands
+//out task numbers one at a time to the workers and the calling thread
+//alike and returns when every task is done. A task that itself calls run
+//has its tasks run inline, and two threads calling run take turns
+class ThreadPool {
+
+public:
+	static ThreadPool& shared();
+	size_t size() const;
+	void run(size_t, const function<void(size_t)>&);
+
+private:
+	vector<thread> workers;
+	mutex lock, submit;
+	condition_variable wake, done;
+	const function<void(size_t)>* job = nullptr;
+	size_t job_tasks = 0, finished = 0;
+	atomic<size_t> next_task{ 0 };
+	unsigned long long generation = 0;
+	bool stopping = false;
+
+	ThreadPool(size_t);
+	~ThreadPool();
+	void work();
+	void drain();
+};
+
+#endif // !THREADPOOL_H
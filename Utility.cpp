@@ -1,6 +1,7 @@
 //Utility.cpp
 #include "stdafx.h"
 #include "Utility.h"
+#include "ThreadPool.h"
 
 //Supporting utility class in order to preform 
 //mathematical operations for the 3D graph
@@ -175,3 +176,139 @@ int Utility::within_std_dev(map<int, int> data, int std_dev, float mu, int size)
 	return trunc(double(100 * within_range) / size);
 }
 
+
+//walks the directionals of a location and sums up the distances
+//along each axis to get the actual point in space
+Position Utility::resolve(Location* loc) {
+	Position pos = { 0, 0, 0 };
+	int dist;
+
+	for (int i = 0; i < loc->directionals.size() && i < loc->distances.size(); i++) {
+		dist = loc->distances.at(i);
+
+		switch (loc->directionals.at(i)) {
+		case NORTH: pos.y += dist; break;
+		case SOUTH: pos.y -= dist; break;
+		case EAST: pos.x += dist; break;
+		case WEST: pos.x -= dist; break;
+		case ASCEND: pos.z += dist; break;
+		case DESCEND: pos.z -= dist; break;
+		default: break;
+		}
+	}
+	return pos;
+}
+
+//interleaves the bits of each axis into a z-order curve key so that
+//points close in space are close in key order. Each axis is biased
+//to be positive and clamped to MORTON_AXIS_BITS
+uint64_t Utility::morton_encode(Position pos) {
+	const int64_t limit = (int64_t(1) << MORTON_AXIS_BITS) - 1;
+	int64_t axis[MAX_COORDINATE_ENTRIES] = { pos.x, pos.y, pos.z };
+
+	for (int i = 0; i < MAX_COORDINATE_ENTRIES; i++) {
+		axis[i] += MORTON_BIAS;
+		axis[i] = axis[i] < 0 ? 0 : (axis[i] > limit ? limit : axis[i]);
+	}
+
+	return spread_bits(uint32_t(axis[0])) | (spread_bits(uint32_t(axis[1])) << 1) |
+		(spread_bits(uint32_t(axis[2])) << 2);
+}
+
+//reverse of morton_encode
+Position Utility::morton_decode(uint64_t key) {
+	Position pos;
+
+	pos.x = int(compact_bits(key)) - MORTON_BIAS;
+	pos.y = int(compact_bits(key >> 1)) - MORTON_BIAS;
+	pos.z = int(compact_bits(key >> 2)) - MORTON_BIAS;
+
+	return pos;
+}
+
+//given a key that lies between the keys of the low and high corner of a
+//box but outside of the box itself, returns the smallest key greater than
+//it that is back inside of the box (BIGMIN from Tropf and Herzog). Lets a
+//range scan over z-order keys jump over the parts that leave the box
+uint64_t Utility::morton_bigmin(uint64_t key, uint64_t low, uint64_t high) {
+	const uint64_t axis_bits = 0x1249249249249249ULL;
+	uint64_t bigmin = 0, bit, below;
+	int pos;
+
+	for (pos = 3 * MORTON_AXIS_BITS - 1; pos >= 0; pos--) {
+		bit = uint64_t(1) << pos;
+
+		//the lower bits belonging to the same axis as this bit
+		below = (axis_bits << (pos % 3)) & (bit - 1);
+
+		switch (((key & bit) ? 4 : 0) | ((low & bit) ? 2 : 0) | ((high & bit) ? 1 : 0)) {
+		case 1:
+			bigmin = (low | bit) & ~below;
+			high = (high & ~bit) | below;
+			break;
+		case 3:
+			return low;
+		case 4:
+			return bigmin;
+		case 5:
+			low = (low | bit) & ~below;
+			break;
+		default:
+			break;
+		}
+	}
+	return bigmin;
+}
+
+//true if the position lies within the box spanned by low and high
+bool Utility::in_box(Position pos, Position low, Position high) {
+	return pos.x >= low.x && pos.x <= high.x && pos.y >= low.y && pos.y <= high.y &&
+		pos.z >= low.z && pos.z <= high.z;
+}
+
+//places two zero bits between each of the lower 21 bits
+uint64_t Utility::spread_bits(uint32_t val) {
+	uint64_t bits = val & 0x1fffff;
+
+	bits = (bits | bits << 32) & 0x1f00000000ffffULL;
+	bits = (bits | bits << 16) & 0x1f0000ff0000ffULL;
+	bits = (bits | bits << 8) & 0x100f00f00f00f00fULL;
+	bits = (bits | bits << 4) & 0x10c30c30c30c30c3ULL;
+	bits = (bits | bits << 2) & 0x1249249249249249ULL;
+
+	return bits;
+}
+
+//gathers every third bit back into a 21 bit integer
+uint32_t Utility::compact_bits(uint64_t bits) {
+	bits &= 0x1249249249249249ULL;
+	bits = (bits ^ (bits >> 2)) & 0x10c30c30c30c30c3ULL;
+	bits = (bits ^ (bits >> 4)) & 0x100f00f00f00f00fULL;
+	bits = (bits ^ (bits >> 8)) & 0x1f0000ff0000ffULL;
+	bits = (bits ^ (bits >> 16)) & 0x1f00000000ffffULL;
+	bits = (bits ^ (bits >> 32)) & 0x1fffffULL;
+
+	return uint32_t(bits);
+}
+
+//the number of workers used by parallel_for
+size_t Utility::thread_count() {
+	return ThreadPool::shared().size();
+}
+
+//splits [0, count) into one contiguous chunk per worker and runs work on
+//each chunk on the shared pool as work(chunk, begin, end). Returns once
+//every chunk is finished. Small ranges are run on the calling thread
+void Utility::parallel_for(size_t count, const function<void(size_t, size_t, size_t)>& work) {
+	const size_t min_chunk = 4096;
+	size_t chunks = min(thread_count(), (count + min_chunk - 1) / min_chunk);
+
+	if (chunks <= 1) {
+		work(0, 0, count);
+		return;
+	}
+
+	ThreadPool::shared().run(chunks, [&](size_t i) {
+		work(i, count * i / chunks, count * (i + 1) / chunks);
+	});
+}
@@ -4,6 +4,7 @@
 #include "stdafx.h"
 #include "radiationgraph.h"
 #include <math.h>
+#include <functional>
 
 #define MAX_PERMUTATIONS 6
 #define ENTRY_SIZE 2
@@ -14,6 +15,13 @@ class Utility {
 	public:
 		static set<string> permutations(string);
 		static string distribution_type(map<int,int>);
+		static Position resolve(Location*);
+		static uint64_t morton_encode(Position);
+		static Position morton_decode(uint64_t);
+		static uint64_t morton_bigmin(uint64_t, uint64_t, uint64_t);
+		static bool in_box(Position, Position, Position);
+		static size_t thread_count();
+		static void parallel_for(size_t, const function<void(size_t, size_t, size_t)>&);
 
 
 	private:
@@ -23,6 +31,8 @@ class Utility {
 		static float get_std_dev(map<int, int>, float, int);
 		static int get_num_vals(map<int, int>);
 		static int within_std_dev(map<int, int>, int, float, int size);
+		static uint64_t spread_bits(uint32_t);
+		static uint32_t compact_bits(uint64_t);
 };
 
 
@@ -0,0 +1,71 @@
+//ValueIndex.cpp
+#include "stdafx.h"
+#include "ValueIndex.h"
+#include "Utility.h"
+
+//Bitmap index for threshold and range queries. The bitmaps hold column
+//indices, so the index is thrown away whenever the column store is rebuilt
+//and patched in place while only values change. VACANT readings are left
+//out of every bitmap. The outside bin is checked against the values
+//themselves since it mixes readings of any value
+
+//the bitmap a value belongs to, MAX_BINS being the outside bin
+size_t ValueIndex::bin(int val) const {
+	return val >= 0 && val < MAX_BINS ? (size_t)val : MAX_BINS;
+}
+
+void ValueIndex::build(const NodeColumns& columns) {
+	bins.assign(MAX_BINS + 1, RoaringBitmap());
+
+	for (size_t i = 0; i < columns.size(); i++) {
+		if (columns.values[i] != VACANT) {
+			bins[bin(columns.values[i])].add((uint32_t)i);
+		}
+	}
+	built = true;
+}
+
+//moves the reading at a column index from its old value to its new one
+void ValueIndex::patch(uint32_t index, int old_val, int new_val) {
+	if (old_val != VACANT) {
+		bins[bin(old_val)].remove(index);
+	}
+	if (new_val != VACANT) {
+		bins[bin(new_val)].add(index);
+	}
+}
+
+//column indices of every reading from low to high inclusive
+RoaringBitmap ValueIndex::range(int low, int high, const NodeColumns& columns) const {
+	RoaringBitmap found;
+
+	for (int val = max(low, 0); val <= min(high, MAX_BINS - 1); val++) {
+		found.add_all(bins[val]);
+	}
+
+	if (low < 0 || high >= MAX_BINS) {
+		for (uint32_t index : bins[MAX_BINS].members()) {
+			if (columns.values[index] >= low && columns.values[index] <= high) {
+				found.add(index);
+			}
+		}
+	}
+	return found;
+}
+
+//memory held by the bitmaps
+size_t ValueIndex::bytes() const {
+	size_t total = 0;
+
+	for (const RoaringBitmap& bitmap : bins) {
+		total += bitmap.bytes();
+	}
+	return total;
+}
+
+bool ValueIndex::is_built() const { return built; }
+
+void ValueIndex::clear() {
+	bins.clear();
+	built = false;
+}
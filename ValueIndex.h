@@ -0,0 +1,27 @@
+#ifndef VALUEINDEX_H
+#define VALUEINDEX_H
+
+#include "NodeColumns.h"
+#include "RoaringBitmap.h"
+
+//which readings of the column store hold each value. Every value the
+//histogram has a bin for, 0 up to MAX_BINS - 1, gets a bitmap of the
+//column indices holding it and the few readings outside of that range
+//share one more, so a range of values is the union of its bitmaps
+class ValueIndex {
+
+public:
+	void build(const NodeColumns&);
+	void patch(uint32_t, int, int);
+	RoaringBitmap range(int, int, const NodeColumns&) const;
+	size_t bytes() const;
+	bool is_built() const;
+	void clear();
+
+private:
+	vector<RoaringBitmap> bins;
+	bool built = false;
+	size_t bin(int) const;
+};
+
+#endif // !VALUEINDEX_H
@@ -0,0 +1,83 @@
+//VersionedStore.cpp
+#include "stdafx.h"
+#include "VersionedStore.h"
+#include <atomic>
+
+//A slot is split into VERSION_BITS wide digits, the top one picking a
+//child of the root and the last one a reading within a leaf. shift is how
+//far the top digit sits above the last, 0 while the root is itself a leaf.
+//A block is only ever changed in place while the store walking to it holds
+//the one reference to it, so copies handed to other threads see blocks
+//that never change under them
+
+//makes the block the pointer refers to one that only it holds, copying it
+//if it is shared
+VersionNode& VersionedStore::own(shared_ptr<VersionNode>& node) {
+	if (node.use_count() != 1) {
+		node = make_shared<VersionNode>(*node);
+	}
+	else {
+		//whoever let go of it last is done reading it
+		atomic_thread_fence(memory_order_acquire);
+	}
+	return *node;
+}
+
+const VersionedReading& VersionedStore::get(size_t slot) const {
+	const VersionNode* node = root.get();
+
+	for (int level = shift; level > 0; level -= VERSION_BITS) {
+		node = node->children[(slot >> level) & VERSION_MASK].get();
+	}
+	return node->readings[slot & VERSION_MASK];
+}
+
+//the reading at a slot, ready to be changed without touching any copy
+//of the store
+VersionedReading& VersionedStore::edit(size_t slot) {
+	VersionNode* node = &own(root);
+
+	for (int level = shift; level > 0; level -= VERSION_BITS) {
+		node = &own(node->children[(slot >> level) & VERSION_MASK]);
+	}
+	return node->readings[slot & VERSION_MASK];
+}
+
+//adds a reading in the next slot, growing the tree a level when it is full
+void VersionedStore::push_back(const VersionedReading& reading) {
+	shared_ptr<VersionNode> top;
+	VersionNode* node;
+
+	if (!root) {
+		root = make_shared<VersionNode>();
+	}
+	else if (count == ((size_t)VERSION_FANOUT << shift)) {
+		top = make_shared<VersionNode>();
+		top->children[0] = root;
+		root = top;
+		shift += VERSION_BITS;
+	}
+
+	node = &own(root);
+
+	for (int level = shift; level > 0; level -= VERSION_BITS) {
+		shared_ptr<VersionNode>& child = node->children[(count >> level) & VERSION_MASK];
+
+		if (!child) {
+			child = make_shared<VersionNode>();
+			child->readings.reserve(level == VERSION_BITS ? VERSION_FANOUT : 0);
+		}
+		node = &own(child);
+	}
+
+	node->readings.push_back(reading);
+	count++;
+}
+
+size_t VersionedStore::size() const { return count; }
+
+void VersionedStore::clear() {
+	root.reset();
+	count = 0;
+	shift = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef VERSIONEDSTORE_H
+#define VERSIONEDSTORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#define VERSION_BITS 5
+#define VERSION_FANOUT (1 << VERSION_BITS)
+#define VERSION_MASK (VERSION_FANOUT - 1)
+
+using namespace std;
+
+//what a version holds of one node. links are the slots of its neighbors
+//in the order north, south, east, west, ascend, descend
+struct VersionedReading {
+	int value;
+	int x, y, z;
+	uint32_t links[6];
+	string coordinate;
+};
+
+//one block of the tree. Leaves hold up to VERSION_FANOUT readings and every
+//other level VERSION_FANOUT children
+struct VersionNode {
+	shared_ptr<VersionNode> children[VERSION_FANOUT];
+	vector<VersionedReading> readings;
+};
+
+//persistent array of readings indexed by slot. Copying a store is a copy
+//of the root pointer, after which both copies share every block. A change
+//copies the blocks on the path down to its slot that are still shared and
+//changes the rest in place, so a store that has not been copied since is
+//changed with no copying at all
+class VersionedStore {
+
+public:
+	const VersionedReading& get(size_t) const;
+	VersionedReading& edit(size_t);
+	void push_back(const VersionedReading&);
+	size_t size() const;
+	void clear();
+
+private:
+	shared_ptr<VersionNode> root;
+	size_t count = 0;
+	int shift = 0;
+	static VersionNode& own(shared_ptr<VersionNode>&);
+};
+
+#endif // !VERSIONEDSTORE_H
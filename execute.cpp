@@ -18,7 +18,15 @@
 
 #include "stdafx.h"
 #include "radiationgraph.h"
+#include "GraphServer.h"
+#include "IngestPipeline.h"
+#include "MergeLoader.h"
+#include "NodeFile.h"
+#include <boost/filesystem.hpp>
+#include "Utility.h"
 #include <fstream>
+#include <chrono>
+#include <mutex>
 
 #define ADD 1
 #define DELETE 2
@@ -27,28 +35,87 @@
 #define CLUSTERS 5
 #define HISTOGRAM 6
 #define EXIT 7
+#define DEFRAGMENT 8
+#define CLUSTER_SWEEP 9
+#define DENSITY_CLUSTERS 10
+#define REGION_TOTALS 11
+#define REGION_SUMMARY 12
+#define TRENDS 13
+#define CHANNELS 14
+#define EXPORT 15
+#define FIND 16
+#define SIMULATE 17
+#define HOTTEST 18
+#define VALUE_RANGE 19
+#define ALERTS 20
+#define SNAPSHOT 21
+#define APPROXIMATE 22
+#define CLUSTER_SUMMARY 23
+#define DOSE_PATH 24
+#define ISOSURFACE 25
 
 void main_loop(RadiationGraph*);
+void load_file(RadiationGraph*, const char*);
+void compare_load(const char*);
+bool merge_files(RadiationGraph*, int, char*[]);
+void out_of_core_loop(NodeFile*);
+void print_found(const string&, const Found&);
+void alert_menu(RadiationGraph*);
+void snapshot_menu(RadiationGraph*, GraphSnapshot&);
+void dose_menu(RadiationGraph*);
 void prompt_help();
 
+//alerts raised on the notifier thread wait here until they are shown
+mutex raised_lock;
+vector<string> raised_alerts;
+
+//rpl [file] runs the menu, rpl [--merge last|max|mean] files... merges
+//several files, directories or wildcards into the graph first, rpl --serve port [file] [--allow-shutdown]
+//shares the graph with local clients, any of which may stop the server only
+//when --allow-shutdown is given, rpl --load port clients requests batch drives a server and
+//rpl --compare-load file times streaming a compressed file in against
+//decompressing it first and rpl --out-of-core nodefile [files...] works on
+//a memory mapped node file, built from the files when they are given
 int main(int argc, char *argv[]) {
 
-	string line;
 	RadiationGraph globe;
-	ifstream in;
+	string mode = argc > 1 ? argv[1] : "";
+
+	if (mode == "--serve" && argc > 2) {
+		GraphServer server(&globe, argc > 3 && string(argv[argc - 1]) == "--allow-shutdown");
 
-	if (argc == HAS_FILE) {
-		//open the file and perform addition to the graph
-		in.open(argv[ADD]);
+		if (argc > 3 && string(argv[3]) != "--allow-shutdown") {
+			load_file(&globe, argv[3]);
+		}
 
-		while (!in.eof()) {
-			getline(in, line);
-			globe.add(&line);
+		if (server.listen_on((unsigned short)atoi(argv[2]))) {
+			server.run();
 		}
+	}
+	else if (mode == "--load" && argc > 5) {
+		GraphServer::load_test("127.0.0.1", (unsigned short)atoi(argv[2]), atoi(argv[3]),
+			atoi(argv[4]), atoi(argv[5]));
+	}
+	else if (mode == "--out-of-core" && argc > 2) {
+		NodeFile store;
 
-		in.close();
+		if (argc > 3 ? store.build(vector<string>(argv + 3, argv + argc), argv[2]) : store.open(argv[2])) {
+			out_of_core_loop(&store);
+		}
+	}
+	else if (mode == "--compare-load" && argc > 2) {
+		compare_load(argv[2]);
+	}
+	else if (argc == HAS_FILE && mode.find_first_of("*?") == string::npos &&
+		!boost::filesystem::is_directory(mode)) {
+		load_file(&globe, argv[ADD]);
 		main_loop(&globe);
 	}
+	else if (argc > 1) {
+		if (merge_files(&globe, argc, argv)) {
+			main_loop(&globe);
+		}
+	}
 	else {
 		main_loop(&globe);
 	}
@@ -56,6 +123,86 @@ int main(int argc, char *argv[]) {
 	return 0;
 }
 
+//open the file and perform addition to the graph. The reader,
+//canonicalizer and inserter each take a thread, the rest parse
+void load_file(RadiationGraph *globe, const char* path) {
+
+	size_t threads = Utility::thread_count();
+	IngestPipeline pipeline(globe, threads > 3 ? threads - 3 : 1);
+
+	if (pipeline.load(path)) {
+		pipeline.print_report();
+	}
+}
+
+//loads every file named on the command line into the one graph. Returns
+//false if the files could not all be read
+bool merge_files(RadiationGraph *globe, int argc, char *argv[]) {
+
+	vector<string> arguments;
+	int rule = MERGE_LAST, first = ADD;
+
+	if (string(argv[ADD]) == "--merge") {
+		if (argc < 4 || (rule = MergeLoader::parse_rule(argv[ADD + 1])) < 0) {
+			cerr << "Error: --merge takes last, max or mean followed by the files" << endl;
+			return false;
+		}
+		first += 2;
+	}
+
+	arguments.assign(argv + first, argv + argc);
+	MergeLoader loader(globe, rule);
+
+	if (!loader.load(arguments)) {
+		return false;
+	}
+
+	loader.print_report();
+	return true;
+}
+
+//times loading a compressed file straight into a graph against
+//decompressing it to disk first and loading the copy
+void compare_load(const char* path) {
+
+	const string copy = string(path) + ".decompressed";
+	size_t threads = Utility::thread_count();
+	double streamed, decompressed, loaded;
+
+	auto start = chrono::high_resolution_clock::now();
+	{
+		RadiationGraph streamed_globe;
+		IngestPipeline pipeline(&streamed_globe, threads > 3 ? threads - 3 : 1);
+
+		if (!pipeline.load(path)) {
+			return;
+		}
+		streamed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		pipeline.print_report();
+	}
+
+	start = chrono::high_resolution_clock::now();
+
+	if (!IngestPipeline::decompress(path, copy)) {
+		return;
+	}
+	decompressed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	start = chrono::high_resolution_clock::now();
+	{
+		RadiationGraph copied_globe;
+		IngestPipeline pipeline(&copied_globe, threads > 3 ? threads - 3 : 1);
+
+		pipeline.load(copy);
+		loaded = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+	remove(copy.c_str());
+
+	cout << "Streaming load: " << streamed << " ms" << endl;
+	cout << "Decompress then load: " << decompressed + loaded << " ms (" << decompressed <<
+		" ms to decompress, " << loaded << " ms to load)" << endl;
+}
+
 //running the cmd user interface and signals the 
 //interaction with the graph
 //makes the huge assumption that the user only enters valid coordinates
@@ -63,8 +210,14 @@ int main(int argc, char *argv[]) {
 void main_loop(RadiationGraph *globe) {
 
 	bool run = true;
-	string coordinates;
-	int option, cluster_dist = 0;
+	string coordinates, answer, path;
+	int option, cluster_dist = 0, list_dist = 0, min_pts = 0, min_value = 0, level = 0, format = 0;
+	double radius = 0;
+	Position low, high;
+	vector<double> weights;
+	Found* found;
+	SimulationSettings simulation;
+	GraphSnapshot what_if;
 	const string HELP_KEYWORD = "HELP";
 
 	while (run) {
@@ -117,10 +270,187 @@ void main_loop(RadiationGraph *globe) {
 
 			globe->print_cluster(cluster_dist);
 			break;
+		case CLUSTER_SUMMARY:
+			cout << "Maximum node distance for each cluster" << endl;
+			cin >> cluster_dist;
+
+			globe->print_cluster_summary(cluster_dist);
+			break;
+		case DENSITY_CLUSTERS:
+			cout << "Radius to search around each reading" << endl;
+			cin >> radius;
+			cout << "Readings needed within the radius to form a cluster" << endl;
+			cin >> min_pts;
+			cout << "Smallest value a reading must have (-1 for any)" << endl;
+			cin >> min_value;
+
+			globe->print_density_clusters(radius, min_pts, min_value);
+			break;
 		case HISTOGRAM:
 			cout << "Displaying histogram now..." << endl;
 			globe->display_histogram();
 			break;
+		case APPROXIMATE:
+			globe->print_approximate_stats();
+			break;
+		case DEFRAGMENT:
+			cout << "Reordering nodes along the z-order curve..." << endl;
+			globe->defragment();
+			break;
+		case CLUSTER_SWEEP:
+			cout << "Largest node distance to sweep" << endl;
+			cin >> cluster_dist;
+			cout << "Distance to list the clusters of (0 for none)" << endl;
+			cin >> list_dist;
+
+			globe->print_cluster_sweep(cluster_dist, list_dist);
+			break;
+		case REGION_TOTALS:
+			cout << "Enter one corner of the region as x y z" << endl;
+			cin >> low.x >> low.y >> low.z;
+			cout << "Enter the opposite corner as x y z" << endl;
+			cin >> high.x >> high.y >> high.z;
+
+			globe->print_region_totals(low, high);
+			break;
+		case REGION_SUMMARY:
+			cout << "Level of detail, cells at level n are 2^n across" << endl;
+			cin >> level;
+			cout << "Enter one corner of the region as x y z" << endl;
+			cin >> low.x >> low.y >> low.z;
+			cout << "Enter the opposite corner as x y z" << endl;
+			cin >> high.x >> high.y >> high.z;
+
+			globe->print_pyramid(level, low, high);
+			break;
+		case DOSE_PATH:
+			dose_menu(globe);
+			break;
+		case TRENDS:
+			if (!globe->is_recording_history()) {
+				cout << "Recording the history of every reading from now on" << endl;
+				globe->set_history(true);
+			}
+			else {
+				cout << "Hourly mean to look for (-1 to stop recording)" << endl;
+				cin >> radius;
+
+				if (radius < 0) {
+					globe->set_history(false);
+				}
+				else {
+					globe->print_trends(radius);
+				}
+			}
+			break;
+		case CHANNELS:
+			cout << "Enter the weight of each of the " << globe->get_channel_count() <<
+				" channels, primary reading first" << endl;
+			weights.assign(globe->get_channel_count(), 0);
+
+			for (double& weight : weights) {
+				cin >> weight;
+			}
+
+			globe->set_channel_mix(weights);
+			break;
+		case EXPORT:
+			cout << "Export as CSV(1), binary(2) or VTK(3)" << endl;
+			cin >> format;
+			cout << "Include neighbor edges? (Y/N)" << endl;
+			cin >> answer;
+			cout << "File to write" << endl;
+			cin >> path;
+
+			if (format < EXPORT_CSV || format > EXPORT_VTK) {
+				cerr << "Error: Invalid format: " << format << endl;
+			}
+			else {
+				globe->export_graph(path, format, answer == "Y" || answer == "y");
+			}
+			break;
+		case ISOSURFACE:
+			cout << "Reading the surface is drawn at" << endl;
+			cin >> radius;
+			cout << "Write as binary PLY(1) or OBJ(2)" << endl;
+			cin >> format;
+			cout << "File to write" << endl;
+			cin >> path;
+
+			if (format < MESH_PLY || format > MESH_OBJ) {
+				cerr << "Error: Invalid format: " << format << endl;
+			}
+			else {
+				globe->export_isosurface(radius, path, format);
+			}
+			break;
+		case FIND:
+			cout << "Enter the coordinates to look for" << endl;
+			cin >> coordinates;
+			boost::to_upper(coordinates);
+
+			found = globe->in_graph(&coordinates);
+			print_found(coordinates, *found);
+			delete found;
+			break;
+		case SIMULATE:
+			cout << "Number of steps to run" << endl;
+			cin >> simulation.steps;
+			cout << "Diffusion rate to each neighbor per step" << endl;
+			cin >> simulation.diffusion;
+			cout << "Decay rate per step" << endl;
+			cin >> simulation.decay;
+			cout << "Edges reflect(0), absorb(1) or hold fixed(2)" << endl;
+			cin >> simulation.boundary;
+			cout << "Keep the result in the graph? (Y/N)" << endl;
+			cin >> answer;
+
+			if (simulation.steps < 0) {
+				cerr << "Error: Invalid number of steps: " << simulation.steps << endl;
+			}
+			else if (simulation.boundary < SIM_REFLECT || simulation.boundary > SIM_FIXED) {
+				cerr << "Error: Invalid boundary: " << simulation.boundary << endl;
+			}
+			else {
+				globe->simulate(simulation, answer == "Y" || answer == "y");
+			}
+			break;
+		case HOTTEST:
+			cout << "Number of locations to list" << endl;
+			cin >> level;
+			cout << "Restrict to a region? (Y/N)" << endl;
+			cin >> answer;
+
+			if (answer == "Y" || answer == "y") {
+				cout << "Enter one corner of the region as x y z" << endl;
+				cin >> low.x >> low.y >> low.z;
+				cout << "Enter the opposite corner as x y z" << endl;
+				cin >> high.x >> high.y >> high.z;
+			}
+
+			globe->print_top_k(max(level, 0), answer == "Y" || answer == "y", low, high);
+			break;
+		case VALUE_RANGE:
+			cout << "Smallest value to look for" << endl;
+			cin >> min_value;
+			cout << "Largest value to look for" << endl;
+			cin >> level;
+			cout << "Maximum node distance to cluster them by (0 to list them)" << endl;
+			cin >> cluster_dist;
+
+			if (cluster_dist > 0) {
+				globe->print_cluster_within(cluster_dist, min_value, level);
+			}
+			else {
+				globe->print_readings_between(min_value, level);
+			}
+			break;
+		case ALERTS:
+			alert_menu(globe);
+			break;
+		case SNAPSHOT:
+			snapshot_menu(globe, what_if);
+			break;
 		case EXIT:
 			run = false;
 			cout << "Exiting..." << endl;
@@ -132,6 +462,189 @@ void main_loop(RadiationGraph *globe) {
 	}
 }
 
+//the menu for a graph kept in a node file, offering the options that
+//stream over it
+void out_of_core_loop(NodeFile *store) {
+
+	bool run = true;
+	string coordinates;
+	int option, cluster_dist = 0;
+
+	while (run) {
+		cout << "Enter the number associated with your selection:\nAdd Item(1)\nSize(3)\n"
+			"Clusters(5)\nHistogram(6)\nExit(7)\nFind(16)\n";
+		cin >> option;
+
+		switch (option) {
+		case ADD:
+			cout << "Enter the coordinates" << endl;
+			cin >> coordinates;
+			boost::to_upper(coordinates);
+			store->add(&coordinates);
+			break;
+		case SIZE:
+			cout << "There are " << store->size() << " readings in the node file" << endl;
+			break;
+		case CLUSTERS:
+			cout << "Maximum node distance for each cluster" << endl;
+			cin >> cluster_dist;
+			store->print_clusters(cluster_dist);
+			break;
+		case HISTOGRAM:
+			cout << "Displaying histogram now..." << endl;
+			store->print_histogram();
+			break;
+		case FIND:
+			cout << "Enter the coordinates to look for" << endl;
+			cin >> coordinates;
+			boost::to_upper(coordinates);
+			print_found(coordinates, store->find(&coordinates));
+			break;
+		case EXIT:
+			run = false;
+			store->flush();
+			cout << "Exiting..." << endl;
+			break;
+		default:
+			cerr << "Error: Invalid selection: " << option << endl;
+		}
+	}
+}
+
+void print_found(const string& coordinates, const Found& found) {
+	if (!found.has_node) {
+		cout << "Coordinate " << coordinates << " is not in the graph" << endl;
+	}
+	else if (!found.has_value) {
+		cout << "Coordinate " << coordinates << " is EMPTY" << endl;
+	}
+	else {
+		cout << "Coordinate " << coordinates << " holds a value" << endl;
+	}
+}
+
+//watches zones of the graph for readings rising past a threshold. The
+//alerts are collected as they are raised and shown when asked for
+void alert_menu(RadiationGraph *globe) {
+	int choice = 0, threshold = 0;
+	size_t id = 0;
+	Position low, high;
+
+	cout << "Watch a zone(1), show raised alerts(2) or stop watching a zone(3)" << endl;
+	cin >> choice;
+
+	if (choice == 1) {
+		cout << "Enter one corner of the zone as x y z" << endl;
+		cin >> low.x >> low.y >> low.z;
+		cout << "Enter the opposite corner as x y z" << endl;
+		cin >> high.x >> high.y >> high.z;
+		cout << "Value that raises an alert" << endl;
+		cin >> threshold;
+
+		id = globe->subscribe_alert(low, high, threshold, [](const Alert& alert) {
+			lock_guard<mutex> hold(raised_lock);
+
+			raised_alerts.push_back("Zone " + to_string(alert.subscription->id) + ": coordinate " +
+				alert.coordinate + " rose to " + to_string(alert.value) + " (threshold " +
+				to_string(alert.subscription->threshold) + ")");
+		});
+		cout << "Watching as zone " << id << endl;
+	}
+	else if (choice == 2) {
+		globe->wait_for_alerts();
+		lock_guard<mutex> hold(raised_lock);
+
+		for (const string& alert : raised_alerts) {
+			cout << alert << endl;
+		}
+		cout << raised_alerts.size() << " alerts raised" << endl;
+		raised_alerts.clear();
+	}
+	else if (choice == 3) {
+		cout << "Zone to stop watching" << endl;
+		cin >> id;
+
+		if (!globe->unsubscribe_alert(id)) {
+			cerr << "Error: No zone " << id << endl;
+		}
+	}
+	else {
+		cerr << "Error: Invalid selection: " << choice << endl;
+	}
+}
+
+//forks the graph to try out hypothetical readings and removals on without
+//touching the graph itself
+void snapshot_menu(RadiationGraph *globe, GraphSnapshot& what_if) {
+	int choice = 0, dist = 0;
+	string coordinates;
+
+	cout << "Take a snapshot(1), give it a reading(2), remove a reading from it(3) "
+		"or show its clusters(4)" << endl;
+	cin >> choice;
+
+	if (choice == 1) {
+		auto start = chrono::high_resolution_clock::now();
+		what_if = globe->snapshot();
+
+		cout << "Snapshot of " << what_if.size() << " nodes taken in " <<
+			chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count() <<
+			" us" << endl;
+	}
+	else if (choice == 2 || choice == 3) {
+		cout << "Enter the coordinates" << (choice == 2 ? " and value" : "") << endl;
+		cin >> coordinates;
+		boost::to_upper(coordinates);
+
+		if (!(choice == 2 ? what_if.set_reading(coordinates) : what_if.remove(coordinates))) {
+			cerr << "Error: " << coordinates << " is not in the snapshot" << endl;
+		}
+	}
+	else if (choice == 4) {
+		cout << "Maximum node distance for each cluster" << endl;
+		cin >> dist;
+
+		what_if.print_clusters(dist);
+	}
+	else {
+		cerr << "Error: Invalid selection: " << choice << endl;
+	}
+}
+
+//the dose taken walking a path through the graph, or how quickly many
+//random paths are walked
+void dose_menu(RadiationGraph *globe) {
+	DoseSettings settings = { DOSE_BACKGROUND, 0 };
+	vector<PathPoint> path;
+	int points = 0, count = 0;
+
+	cout << "Cells without a reading count as the background(0), the last reading(1) "
+		"or end the path(2)" << endl;
+	cin >> settings.missing;
+	cout << "Background value" << endl;
+	cin >> settings.background;
+	cout << "Points along the path (0 to time random paths)" << endl;
+	cin >> points;
+
+	if (points > 0) {
+		path.resize(points);
+
+		for (PathPoint& point : path) {
+			cout << "Enter the next point as x y z" << endl;
+			cin >> point.x >> point.y >> point.z;
+		}
+		globe->print_dose_along_path(path, settings);
+	}
+	else {
+		cout << "Number of random paths" << endl;
+		cin >> count;
+		cout << "Points along each path" << endl;
+		cin >> points;
+
+		globe->benchmark_paths(count, points, settings);
+	}
+}
+
 //prompt to enter a coordinate or display the 
 //help display
 void prompt_help() {
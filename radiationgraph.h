@@ -8,13 +8,37 @@
 #define VACANT -1
 #define MAX_COORDINATE_ENTRIES 3
 #define MAX_BINS 101
+#define MAX_FINGERS 16
+#define MORTON_AXIS_BITS 21
+#define MORTON_BIAS (1 << 20)
+#define PARALLEL_CHUNK 4096
+#define PATH_CHUNK 16
 
 #include <iostream>
 #include <string>
 #include <vector>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <map>
 #include <set>
+#include <cstdint>
+#include "NodeColumns.h"
+#include "Dendrogram.h"
+#include "DensityClustering.h"
+#include "RegionTable.h"
+#include "AggregatePyramid.h"
+#include "ReadingHistory.h"
+#include "Exporter.h"
+#include "Simulation.h"
+#include "HotspotIndex.h"
+#include "ValueIndex.h"
+#include "AlertMonitor.h"
+#include "GraphSnapshot.h"
+#include "ApproximateStats.h"
+#include "DoseGrid.h"
+#include "IsoSurface.h"
+#include "ThreadPool.h"
+#include <unordered_map>
 
 const char NORTH = 'N';
 const char SOUTH = 'S';
@@ -31,10 +55,12 @@ using namespace std;
 //contains the list of locations where each index in both arrays
 //corresponds to the direction, then amount to travel in that direction.
 //the last integer in the distances array represents the percentage at that location
+//channels holds any readings beyond the primary one (ex. A2W2N5-45,12,3)
 struct Location {
 	string coordinate;
 	vector<char> directionals;
 	vector<int> distances;
+	vector<int> channels;
 };
 
 //returned from the find function.  node corresponds 
@@ -45,6 +71,12 @@ struct Found {
 	bool has_node, has_value;
 };
 
+//a coordinate resolved into 3D space where east, north and ascend
+//are the positive x, y and z axis
+struct Position {
+	int x, y, z;
+};
+
 //contains the location information and value with references 
 //to the nearby nodes in order to establish a 3D grid of
 //points
@@ -52,13 +84,60 @@ struct Node {
 	Node* north = nullptr, *south = nullptr, *east = nullptr, *west = nullptr,
 		*ascend = nullptr, *descend = nullptr;
 	int val = VACANT;
+	uint32_t id = NO_NEIGHBOR;
+	uint32_t slot = NO_NEIGHBOR;
 	Location* location_info;
 };
 
+//what a parallel pass over the graph sees of one node. value is what the
+//analyses run over and neighbors holds the index of each neighbor in the
+//order north, south, east, west, ascend, descend (NO_NEIGHBOR if none)
+//with its value alongside (VACANT if none)
+struct NodeView {
+	uint32_t index;
+	const Node* node;
+	int value;
+	Position position;
+	uint32_t neighbors[6];
+	int neighbor_values[6];
+
+	const string& coordinate() const { return node->location_info->coordinate; }
+};
+
+//what one cluster adds up to over the values the analyses run over. The
+//centroid weighs the position of each member by its value and peak is the
+//member with the highest value, the first along the z-order curve on a tie
+struct ClusterSummary {
+	size_t count;
+	long long sum;
+	double mean;
+	int max;
+	Position low, high;
+	double centroid[3];
+	const Location* peak;
+};
+
+//a position that a previous insertion walked through on the last level of
+//its coordinate.  node and prev are the arguments addRecursive was entered
+//with at that level and bound is the distance that insertion was heading
+//for along the level's directional. any later insertion sharing the
+//coordinate prefix whose distance is at least the bound would have walked
+//through the same spot
+struct Finger {
+	Node* node, *prev;
+	int level, bound;
+	unsigned long version, last_used;
+};
+
 //graph which consists of dynamically allocated chunks of information
 //with references to neighbors in 3D space (x,y,z)
 class RadiationGraph {
 
+	//the loaders parse and insert on their own threads
+	friend class IngestPipeline;
+	friend class MergeLoader;
+	friend class NodeFile;
+
 public:
 	RadiationGraph();
 	~RadiationGraph();
@@ -66,27 +145,157 @@ public:
 	size_t getSize();
 	int explicit_size();
 	void display_histogram();
+	void print_approximate_stats();
 	void print_cluster(const int);
+	void print_cluster_summary(const int);
+	void print_cluster_within(const int, const int, const int);
+	void print_cluster_sweep(const int, const int);
+	void print_density_clusters(const double, const int, const int);
+	void print_region_totals(Position, Position);
+	void print_pyramid(const int, Position, Position);
+	void set_history(bool);
+	bool is_recording_history();
+	void print_trends(const double);
+	void set_channel_mix(const vector<double>&);
+	size_t get_channel_count();
+	void export_graph(const string&, const int, const bool);
+	void export_isosurface(const double, const string&, const int);
+	void simulate(const SimulationSettings&, const bool);
+	RegionTotals region_totals(Position, Position);
+	vector<RegionTotals> region_totals(const vector<pair<Position, Position>>&);
+	vector<ClusterSummary> summarize_clusters(const int);
+	vector<vector<uint32_t>> cluster_members(const int, const RoaringBitmap*);
+	const NodeColumns& get_columns();
+	vector<Hotspot> top_k(size_t);
+	vector<Hotspot> top_k(size_t, Position, Position);
+	void print_top_k(size_t, const bool, Position, Position);
+	RoaringBitmap readings_between(const int, const int);
+	void print_readings_between(const int, const int);
+	PathDose dose_along_path(const vector<PathPoint>&, const DoseSettings&);
+	vector<PathDose> dose_along_paths(const vector<vector<PathPoint>>&, const DoseSettings&);
+	void print_dose_along_path(const vector<PathPoint>&, const DoseSettings&);
+	void benchmark_paths(const int, const int, const DoseSettings&);
+	size_t subscribe_alert(Position, Position, const int, const function<void(const Alert&)>&);
+	bool unsubscribe_alert(size_t);
+	void wait_for_alerts();
+	GraphSnapshot snapshot();
 	void add(string*);
 	void remove(string*);
 	void display(int);
+	void defragment();
+	vector<Node*> nodes_in_box(Position, Position);
 	Found* in_graph(string*);
 	const map<string, Node*> getCurrentKnowledgeBase() const;
+	template <typename Function> void parallel_for_each(Function);
+	template <typename T, typename Fold, typename Combine> T parallel_reduce(const T&, Fold, Combine);
 
 private:
 	int additions;
+	unsigned long structure_version = 0, finger_clock = 0;
+	unsigned long mutations = 0, dendrogram_version = 0;
 	Node* centroid = nullptr;
 	map<string, Node*> knowledge_base;
-	void parseCommand(string*, Node*);
+	map<string, Finger> fingers;
+	string finger_at;
+	multimap<uint64_t, Node*> morton_index;
+	Node* node_pool = nullptr;
+	size_t pool_size = 0;
+	NodeColumns columns;
+	bool columns_dirty = true;
+	Dendrogram dendrogram;
+	RegionTable region_table;
+	bool region_stale = true;
+	AggregatePyramid pyramid;
+	HotspotIndex hotspots;
+	ValueIndex value_index;
+	ApproximateStats approximate;
+	DoseGrid dose_grid;
+	AlertMonitor alerts;
+	uint32_t slots = 0;
+	VersionedStore versions;
+	bool versioning = false;
+	vector<Node*> fresh_nodes;
+	bool history_enabled = false;
+	unordered_map<string, ReadingHistory> history;
+	size_t channel_count = 1;
+	vector<double> channel_weights;
+	void register_node(const string&, Node*);
+	void set_value(Node*, int);
+	void set_reading(Node*, Node*);
+	void notify_change(Node*, const Position&, int, int);
+	bool refresh_region_table();
+	void refresh_hotspots();
+	void refresh_value_index();
+	void refresh_dose_grid();
+	VersionedReading version_of(Node*, const Position&);
+	void settle_versions();
+	void refresh_columns();
+	void refresh_dendrogram();
+	bool is_pooled(Node*);
+	bool in_columns(Node*);
+	static void parseCommand(string*, Node*);
 	void addRecursive(Node*, Node*, Node*, int);
-	int parseInt(string*, int*);
-	int get_directional_dist(Node*, const char);
+	string finger_key(Location*, int);
+	void record_finger(Node*, Node*, Location*, int);
+	bool resume_from_finger(Node*);
+	void invalidate_fingers();
+	static int parseInt(string*, int*);
 	void updateLocation(Node*, Location*, int);
-	Node* isMatch(Location*);
-	vector<set<Node*>> get_communities_of_size(const int);
-	set<Node*>* depth_first_analysis(Node*, const int);
-	void depth_first_analysis_helper(set<Node*>*, Node*, const int);
+	Node* isMatch(const set<string>&);
+	void insert(Node*, const set<string>&);
+	vector<set<Node*>> get_communities_of_size(const int, const RoaringBitmap*);
+	void print_communities(const vector<set<Node*>>&, const int);
 	string to_string(Node*);
+	void fill_view(NodeView&, uint32_t) const;
 };
 
+//calls function(const NodeView&) once for every node. The nodes are handed
+//out in z-order chunks of PARALLEL_CHUNK to the shared pool, so the order
+//of the calls is not fixed and function must be safe to call concurrently
+template <typename Function>
+void RadiationGraph::parallel_for_each(Function function) {
+	size_t chunks;
+
+	refresh_columns();
+	chunks = (columns.size() + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+
+	ThreadPool::shared().run(chunks, [&](size_t chunk) {
+		size_t end = min(columns.size(), (chunk + 1) * PARALLEL_CHUNK);
+		NodeView view;
+
+		for (size_t i = chunk * PARALLEL_CHUNK; i < end; i++) {
+			fill_view(view, (uint32_t)i);
+			function(view);
+		}
+	});
+}
+
+//folds every node into a result. Each chunk starts from its own copy of
+//identity and calls fold(T&, const NodeView&) for its nodes, then the
+//chunks are joined with combine(T&, const T&) in z-order, so the result is
+//the same however the chunks were scheduled
+template <typename T, typename Fold, typename Combine>
+T RadiationGraph::parallel_reduce(const T& identity, Fold fold, Combine combine) {
+	vector<T> partials;
+	T result = identity;
+
+	refresh_columns();
+	partials.assign((columns.size() + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK, identity);
+
+	ThreadPool::shared().run(partials.size(), [&](size_t chunk) {
+		size_t end = min(columns.size(), (chunk + 1) * PARALLEL_CHUNK);
+		NodeView view;
+
+		for (size_t i = chunk * PARALLEL_CHUNK; i < end; i++) {
+			fill_view(view, (uint32_t)i);
+			fold(partials[chunk], view);
+		}
+	});
+
+	for (const T& partial : partials) {
+		combine(result, partial);
+	}
+	return result;
+}
+
 #endif
@@ -0,0 +1,158 @@
+//ClusterTests.cpp
+#include "stdafx.h"
+#include "Tests.h"
+#include "radiationgraph.h"
+#include "Dendrogram.h"
+#include "GraphSnapshot.h"
+#include <iostream>
+#include <sstream>
+#include <climits>
+
+//every way of finding the clusters at a distance has to come up with the
+//same ones: the listing print_cluster prints (user-028), the cut of the
+//single linkage tree and its cluster curve (user-029), the clusters of a
+//snapshot (user-046) and the cluster summaries (user-048). Members are
+//compared by coordinate
+
+typedef set<set<string>> Clusters;
+
+#define CLUSTER_TEST_DISTANCE 4
+
+//a tight block, runs spaced out by 2 and 3, a reading of 0 and a reading
+//that is taken away again
+static void add_fixture(RadiationGraph& globe) {
+	const char* readings[] = { "N1E1-10", "N1E2-12", "N2E1-14", "N2E2-9", "A1N1E1-20", "N1E3-0",
+		"N5E5-7", "N5E7-8", "N5E9-30", "S4W4-50", "S4W7-55", "S7W7-60", "S10W7-61", "A3N9E9-5",
+		"A2N2E2-40", "A2N2E3-41" };
+	string command;
+
+	for (const char* reading : readings) {
+		command = reading;
+		globe.add(&command);
+	}
+	command = "A2N2E3";
+	globe.remove(&command);
+}
+
+//a block of readings with gaps of different sizes cut into it so that the
+//clusters split apart differently at every distance
+static void add_block(RadiationGraph& globe) {
+	ostringstream command;
+	string text;
+
+	for (int a = 1; a <= 3; a++) {
+		for (int n = 1; n <= 12; n++) {
+			for (int e = 1; e <= 12; e++) {
+				if ((n * 7 + e * 3 + a) % 5 == 0 || (n % 4 == 0 && e % 3 != 0)) {
+					continue;
+				}
+
+				command.str("");
+				command << "A" << a << "N" << n << "E" << e << "-" << (n * 13 + e * 7 + a) % 50;
+				text = command.str();
+				globe.add(&text);
+			}
+		}
+	}
+}
+
+static bool check_distance(RadiationGraph& globe, const int dist) {
+	const NodeColumns& columns = globe.get_columns();
+	vector<vector<uint32_t>> listed = globe.cluster_members(dist, nullptr);
+	vector<bool> claimed(columns.size(), false);
+	Clusters walked, masked, snapshotted, cut;
+	RoaringBitmap readings = globe.readings_between(0, INT_MAX);
+	vector<ClusterSummary> summaries = globe.summarize_clusters(dist);
+	GraphSnapshot copy = globe.snapshot();
+	Dendrogram tree;
+	string at = " at distance " + to_string(dist);
+	bool passed = true;
+
+	for (size_t i = 0; i < listed.size(); i++) {
+		set<string> members;
+
+		passed &= expect(listed[i].size() > 1, "no cluster of a single reading" + at);
+		passed &= expect(i == 0 || listed[i - 1].front() < listed[i].front(),
+			"clusters in order of their first member" + at);
+
+		for (uint32_t index : listed[i]) {
+			passed &= expect(columns.values[index] != VACANT, "no vacant node in a cluster" + at);
+			passed &= expect(!claimed[index], "every reading in one cluster at most" + at);
+			claimed[index] = true;
+			members.insert(columns.nodes[index]->location_info->coordinate);
+		}
+		walked.insert(members);
+	}
+
+	for (const vector<uint32_t>& cluster : globe.cluster_members(dist, &readings)) {
+		set<string> members;
+
+		for (uint32_t index : cluster) {
+			members.insert(columns.nodes[index]->location_info->coordinate);
+		}
+		masked.insert(members);
+	}
+
+	for (const vector<uint32_t>& cluster : copy.clusters(dist)) {
+		set<string> members;
+
+		for (uint32_t slot : cluster) {
+			members.insert(copy.reading(slot).coordinate);
+		}
+		snapshotted.insert(members);
+	}
+
+	tree.build(columns);
+
+	for (const vector<uint32_t>& cluster : tree.clusters_at(dist)) {
+		set<string> members;
+
+		for (uint32_t index : cluster) {
+			members.insert(columns.nodes[index]->location_info->coordinate);
+		}
+		cut.insert(members);
+	}
+
+	passed &= expect(masked == walked, "a mask of every reading to change nothing" + at);
+	passed &= expect(snapshotted == walked, "the snapshot clusters to match the listing" + at);
+	passed &= expect(cut == walked, "the linkage tree cut to match the listing" + at);
+	passed &= expect(tree.cluster_curve(dist)[dist] == (int)listed.size(),
+		"the cluster curve to count the listed clusters" + at);
+
+	if (!expect(summaries.size() == listed.size(), "a summary for every listed cluster" + at)) {
+		return false;
+	}
+
+	//the summaries come in the same order as the listing
+	for (size_t i = 0; i < listed.size(); i++) {
+		long long sum = 0;
+		int max = VACANT;
+
+		for (uint32_t index : listed[i]) {
+			sum += columns.values[index];
+			max = std::max(max, columns.values[index]);
+		}
+
+		passed &= expect(summaries[i].count == listed[i].size() && summaries[i].sum == sum &&
+			summaries[i].max == max, "summary " + to_string(i + 1) + " to add up its cluster" + at);
+	}
+
+	return passed;
+}
+
+bool cluster_tests() {
+	RadiationGraph fixture, block;
+	bool passed = true;
+
+	add_fixture(fixture);
+	add_block(block);
+
+	passed &= expect(fixture.cluster_members(0, nullptr).empty(), "no clusters at distance 0");
+
+	for (int dist = 1; dist <= CLUSTER_TEST_DISTANCE; dist++) {
+		passed &= check_distance(fixture, dist);
+		passed &= check_distance(block, dist);
+	}
+
+	return passed;
+}
@@ -0,0 +1,78 @@
+//ColumnTests.cpp
+#include "stdafx.h"
+#include "Tests.h"
+#include "radiationgraph.h"
+#include <iostream>
+#include <sstream>
+#include <climits>
+
+//with a channel mix active, a changed reading is patched into the column
+//store, the value index and the dose grid in place (user-034). A graph
+//changed after they were built has to answer the same as one built from
+//the final readings
+
+//a block of readings with two extra channels, each line of the block
+//later overwritten when round is 1
+static string block_reading(int a, int n, int e, int round) {
+	ostringstream command;
+	int seed = a * 31 + n * 7 + e + round * 13;
+
+	command << "A" << a << "N" << n << "E" << e << "-" << seed % 40;
+
+	//every fourth overwrite drops the channels
+	if (round == 0 || seed % 4 != 0) {
+		command << "," << seed % 11 << "," << (seed * 3) % 17;
+	}
+	return command.str();
+}
+
+static void add_block(RadiationGraph& globe, int round, bool all) {
+	string command;
+
+	for (int a = 1; a <= 2; a++) {
+		for (int n = 1; n <= 8; n++) {
+			for (int e = 1; e <= 8; e++) {
+				if (all || (n + e) % 3 == 0) {
+					command = block_reading(a, n, e, round);
+					globe.add(&command);
+				}
+			}
+		}
+	}
+}
+
+bool column_tests() {
+	const vector<double> weights = { 0.5, 1.0, 2.0 };
+	const vector<PathPoint> path = { { 0, 0, 0 }, { 9, 9, 3 }, { 0, 9, 0 } };
+	const DoseSettings settings = { DOSE_BACKGROUND, 0 };
+	RadiationGraph patched, fresh;
+	string command;
+	bool passed = true;
+
+	//the fresh graph gets the same first readings so both lay out alike
+	add_block(patched, 0, true);
+	add_block(fresh, 0, true);
+	patched.set_channel_mix(weights);
+	fresh.set_channel_mix(weights);
+
+	//build the index and the grid, then change readings under them
+	patched.readings_between(0, INT_MAX);
+	patched.dose_along_path(path, settings);
+	add_block(patched, 1, false);
+	add_block(fresh, 1, false);
+	command = "A2N8E8-0";
+	patched.add(&command);
+	fresh.add(&command);
+
+	const NodeColumns& changed = patched.get_columns();
+	const NodeColumns& rebuilt = fresh.get_columns();
+
+	passed &= expect(changed.values == rebuilt.values, "the mixed values to match a rebuild");
+	passed &= expect(changed.channels == rebuilt.channels, "the channel columns to match a rebuild");
+	passed &= expect(patched.readings_between(5, 30).members() == fresh.readings_between(5, 30).members(),
+		"the value index to match a rebuild");
+	passed &= expect(patched.dose_along_path(path, settings).dose == fresh.dose_along_path(path, settings).dose,
+		"the dose grid to match a rebuild");
+
+	return passed;
+}
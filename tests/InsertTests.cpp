@@ -0,0 +1,51 @@
+//InsertTests.cpp
+#include "stdafx.h"
+#include "Tests.h"
+#include "radiationgraph.h"
+#include <iostream>
+
+//a reading spelled with a leading zero is not found among the spellings of
+//the coordinate already in the graph, so the insertion walks down to it and
+//overwrites it once the last coordinate is the same distance away (user-033).
+//The reading has to land on the node at that distance, not on the node the
+//walk came from
+static bool check_overwrite(const string& first, const string& second, const string& key) {
+	RadiationGraph globe;
+	string command;
+	map<string, Node*> nodes;
+	int readings = 0;
+	bool passed = true;
+
+	command = first + "-3";
+	globe.add(&command);
+	command = second + "-5";
+	globe.add(&command);
+
+	nodes = globe.getCurrentKnowledgeBase();
+
+	passed &= expect(nodes.count(key) == 1 && nodes[key]->val == 5, key + " overwritten by " + second);
+	passed &= expect(nodes.count(second) == 0, second + " not added as a node of its own");
+
+	for (auto& entry : nodes) {
+		readings += entry.second->val != VACANT ? 1 : 0;
+	}
+	passed &= expect(readings == 1, "only " + key + " to hold a reading after " + second);
+
+	return passed;
+}
+
+bool insert_tests() {
+	const char* directions[] = { "A", "D", "N", "S", "E", "W" };
+	bool passed = true;
+
+	//once straight off of the centroid and once a level down, the level
+	//above taken along another axis
+	for (const char* direction : directions) {
+		string single = direction, above = single == "N" || single == "S" ? "E2" : "N2";
+
+		passed &= check_overwrite(single + "1", single + "01", single + "1");
+		passed &= check_overwrite(above + single + "1", above + single + "01", above + single + "1");
+	}
+
+	return passed;
+}
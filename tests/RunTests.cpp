@@ -0,0 +1,34 @@
+//RunTests.cpp
+#include "stdafx.h"
+#include "Tests.h"
+#include <iostream>
+
+//runs every test and exits with the number of them that failed
+int main() {
+	struct Test {
+		const char* name;
+		bool (*run)();
+	};
+
+	const Test tests[] = {
+		{ "clusters", cluster_tests },
+		{ "insert", insert_tests },
+		{ "columns", column_tests },
+	};
+	int failed = 0;
+
+	for (const Test& test : tests) {
+		bool passed = test.run();
+
+		cout << (passed ? "PASS " : "FAIL ") << test.name << endl;
+		failed += passed ? 0 : 1;
+	}
+	return failed;
+}
+
+bool expect(bool held, const string& what) {
+	if (!held) {
+		cout << " expected " << what << endl;
+	}
+	return held;
+}
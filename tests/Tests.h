@@ -0,0 +1,16 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <string>
+
+using namespace std;
+
+//every test prints what went wrong and returns false on a failure
+bool cluster_tests();
+bool insert_tests();
+bool column_tests();
+
+//reports a failed expectation, returns whether it held
+bool expect(bool, const string&);
+
+#endif // !TESTS_H